@@ -0,0 +1,332 @@
+// Microbenchmarks for the core operations at several table sizes, printed as JSON so runs
+// can be compared between releases:
+//
+//   bench [--rows 10000,100000,1000000,10000000] [--only insert,select,...] [--out file.json]
+//
+// Benchmarks: insert (Insert, one row per call), select_index / select_scan (Select on an
+// indexed / unindexed column), parse (parsing and planning a SELECT without running it),
+// query (ExecuteQuery of a point SELECT, drained), serialize (Serialize), load
+// (LoadFromFile of a saved snapshot). Each reports ns/op, rows/s, heap bytes allocated
+// and the peak RSS seen while it ran. The table is the students table of the synthetic
+// dataset (datagen.hpp).
+
+#include <query.hpp>
+#include <datagen.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+
+/* =======================
+   MEASUREMENT
+   ======================= */
+
+// Peak resident set size in KiB. On Linux the high-water mark is reset before each
+// benchmark, so it covers that benchmark only; elsewhere it is the process peak so far.
+void ResetPeakRss()
+{
+#ifdef __linux__
+    std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
+
+uint64_t PeakRssKb()
+{
+#ifdef __linux__
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+        if (line.rfind("VmHWM:", 0) == 0)
+            return std::strtoull(line.c_str() + 6, nullptr, 10);
+#endif
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc));
+    return pmc.PeakWorkingSetSize / 1024;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss) / 1024;
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#endif
+#endif
+}
+
+struct Result
+{
+    std::string name;
+    size_t tableRows = 0;
+    size_t ops = 0;
+    size_t rowsProcessed = 0;
+    double nanos = 0.0;
+    uint64_t bytesAllocated = 0;
+    uint64_t peakRssKb = 0;
+
+    json ToJson() const
+    {
+        double seconds = nanos / 1e9;
+        return {
+            {"name", name},
+            {"table_rows", tableRows},
+            {"ops", ops},
+            {"ns_per_op", ops ? nanos / static_cast<double>(ops) : 0.0},
+            {"rows_per_s", seconds > 0.0 ? static_cast<double>(rowsProcessed) / seconds : 0.0},
+            {"bytes_allocated", bytesAllocated},
+            {"peak_rss_kb", peakRssKb}
+        };
+    }
+};
+
+// Times `body` (which returns the rows it processed) as `ops` operations
+template <typename F>
+Result Measure(const std::string& name, size_t tableRows, size_t ops, F&& body)
+{
+    Result r;
+    r.name = name;
+    r.tableRows = tableRows;
+    r.ops = ops;
+
+    ResetPeakRss();
+    uint64_t bytes = ThreadAllocatedBytes();
+    auto start = std::chrono::steady_clock::now();
+    r.rowsProcessed = body();
+    r.nanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    r.bytesAllocated = ThreadAllocatedBytes() - bytes;
+    r.peakRssKb = PeakRssKb();
+    return r;
+}
+
+// Keeps the optimizer from dropping results nobody reads
+uint64_t g_sink = 0;
+
+/* =======================
+   DATA
+   ======================= */
+
+// The students table of the synthetic dataset, with `n` rows
+DatasetConfig StudentsConfig(size_t n)
+{
+    DatasetConfig cfg;
+    cfg.students = n;
+    return cfg;
+}
+
+// Rows are built in chunks outside the timed region so only Insert is measured
+constexpr size_t kInsertChunk = 65536;
+
+Result BenchInsert(Database& db, size_t n)
+{
+    DatasetConfig cfg = StudentsConfig(n);
+    DatasetTable spec = DatasetTables(cfg).front();
+    Table& table = db.CreateTable(spec.name);
+    for (const auto& a : spec.schema)
+        table.AddColumn(a);
+    CreateIndex(table, "id");
+
+    DatasetRng rng = DatasetTableRng(cfg.seed, spec.name);
+    std::vector<json> chunk;
+    chunk.reserve(std::min(n, kInsertChunk));
+
+    Result total;
+    total.name = "insert";
+    total.tableRows = n;
+    total.ops = n;
+    for (size_t done = 0; done < n; done += chunk.size())
+    {
+        chunk.clear();
+        for (size_t i = done; i < std::min(n, done + kInsertChunk); ++i)
+            chunk.push_back(spec.row(i + 1, rng));
+
+        Result part = Measure("insert", n, chunk.size(), [&] {
+            for (const auto& row : chunk)
+                Insert(table, row);
+            return chunk.size();
+        });
+        total.rowsProcessed += part.rowsProcessed;
+        total.nanos += part.nanos;
+        total.bytesAllocated += part.bytesAllocated;
+        total.peakRssKb = std::max(total.peakRssKb, part.peakRssKb);
+    }
+    return total;
+}
+
+// Enough lookups for a stable number without spending minutes on the largest tables
+size_t PointOps(size_t n) { return std::min<size_t>(n, 10000); }
+size_t ScanOps(size_t n) { return std::clamp<size_t>(20000000 / n, 3, 200); }
+
+/* =======================
+   BENCHMARKS
+   ======================= */
+
+using BenchFn = std::function<Result(Database&, size_t)>;
+
+struct Benchmark
+{
+    std::string name;
+    BenchFn run;
+};
+
+std::vector<Benchmark> Benchmarks(const std::filesystem::path& snapshot)
+{
+    return {
+        {"select_index", [](Database& db, size_t n) {
+            const Table& table = db.GetTable("students");
+            std::mt19937_64 rng(7);
+            size_t ops = PointOps(n);
+            return Measure("select_index", n, ops, [&] {
+                size_t rows = 0;
+                for (size_t i = 0; i < ops; ++i)
+                    rows += Select(table, "id", static_cast<int64_t>(rng() % n + 1)).size();
+                return rows;
+            });
+        }},
+        {"select_scan", [](Database& db, size_t n) {
+            const Table& table = db.GetTable("students");
+            size_t ops = ScanOps(n);
+            return Measure("select_scan", n, ops, [&] {
+                for (size_t i = 0; i < ops; ++i)
+                    g_sink += Select(table, "major", kDatasetMajors[i % std::size(kDatasetMajors)]).size();
+                return ops * n;
+            });
+        }},
+        {"parse", [](Database& db, size_t n) {
+            size_t ops = 10000;
+            return Measure("parse", n, ops, [&] {
+                for (size_t i = 0; i < ops; ++i)
+                {
+                    QueryParser parser("SELECT students WHERE year = " + std::to_string(2015 + i % 10)
+                        + " AND gpa > 3.5 AND major = \"Physics\"");
+                    auto st = PlanStatement(db, parser);
+                    g_sink += st.plan.root->slots.size();
+                }
+                return size_t(0);
+            });
+        }},
+        {"query", [](Database& db, size_t n) {
+            std::mt19937_64 rng(11);
+            size_t ops = PointOps(n);
+            return Measure("query", n, ops, [&] {
+                size_t rows = 0;
+                for (size_t i = 0; i < ops; ++i)
+                    rows += ExecuteQuery(db, "SELECT students WHERE id = " + std::to_string(rng() % n + 1)).Drain().size();
+                return rows;
+            });
+        }},
+        {"serialize", [](Database& db, size_t n) {
+            return Measure("serialize", n, 1, [&] {
+                json j = Serialize(db);
+                g_sink += j.size();
+                return n;
+            });
+        }},
+        {"load", [snapshot](Database& db, size_t n) {
+            SaveToFile(db, snapshot.string());
+            Database loaded("bench");
+            Result r = Measure("load", n, 1, [&] {
+                LoadFromFile(loaded, snapshot.string());
+                return n;
+            });
+            std::filesystem::remove(snapshot);
+            return r;
+        }},
+    };
+}
+
+std::vector<std::string> SplitList(const std::string& s)
+{
+    std::vector<std::string> out;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (!item.empty()) out.push_back(item);
+    return out;
+}
+
+bool Selected(const std::vector<std::string>& only, const std::string& name)
+{
+    return only.empty() || std::find(only.begin(), only.end(), name) != only.end();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::vector<size_t> sizes = { 10000, 100000, 1000000, 10000000 };
+    std::vector<std::string> only;
+    std::string outPath;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            std::cerr << "usage: bench [--rows N,N,...] [--only name,...] [--out file.json]\n";
+            return 2;
+        }
+        if (arg == "--rows")
+        {
+            sizes.clear();
+            for (const auto& s : SplitList(argv[++i]))
+                sizes.push_back(std::strtoull(s.c_str(), nullptr, 10));
+        }
+        else if (arg == "--only") only = SplitList(argv[++i]);
+        else if (arg == "--out") outPath = argv[++i];
+        else
+        {
+            std::cerr << "unknown option: " << arg << "\n";
+            return 2;
+        }
+    }
+
+    auto snapshot = std::filesystem::temp_directory_path() / "student_management_bench.json";
+    json results = json::array();
+
+    for (size_t n : sizes)
+    {
+        if (n == 0) continue;
+        Database db("bench");
+
+        // every other benchmark reads the table the insert benchmark builds
+        Result insert = BenchInsert(db, n);
+        if (Selected(only, "insert")) results.push_back(insert.ToJson());
+        std::cerr << "insert @ " << n << " rows done\n";
+
+        for (const auto& b : Benchmarks(snapshot))
+        {
+            if (!Selected(only, b.name)) continue;
+            results.push_back(b.run(db, n).ToJson());
+            std::cerr << b.name << " @ " << n << " rows done\n";
+        }
+    }
+
+    json report = {{"benchmarks", results}, {"checksum", g_sink}};
+    if (outPath.empty())
+        std::cout << report.dump(2) << "\n";
+    else
+        std::ofstream(outPath) << report.dump(2) << "\n";
+    return 0;
+}
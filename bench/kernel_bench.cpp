@@ -0,0 +1,159 @@
+// Filter kernel microbenchmarks: each kernel at every instruction set the CPU supports,
+// against the scalar path, plus a filtered SeqScan over a table at each level.
+//
+//   kernel_bench [values]
+
+#include <query.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+constexpr int kRepeats = 20;
+
+template <typename F>
+double NanosPerValue(size_t n, F&& run)
+{
+    run();  // warm up
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < kRepeats; ++r)
+        run();
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return ns / (static_cast<double>(n) * kRepeats);
+}
+
+// Keeps the optimizer from dropping kernel output nobody reads
+uint64_t g_sink = 0;
+
+uint64_t Checksum(const std::vector<uint64_t>& bits)
+{
+    uint64_t sum = 0;
+    for (uint64_t w : bits) sum += static_cast<uint64_t>(std::popcount(w));
+    return sum;
+}
+
+void Report(const char* name, SimdLevel level, double ns, double scalarNs)
+{
+    std::printf("%-28s %-8s %8.3f ns/value %8.1f Mvalues/s %6.2fx\n",
+        name, SimdLevelName(level), ns, 1e3 / ns, scalarNs / ns);
+}
+
+std::vector<SimdLevel> Levels()
+{
+    std::vector<SimdLevel> levels;
+    for (int l = 0; l <= static_cast<int>(DetectSimdLevel()); ++l)
+        levels.push_back(static_cast<SimdLevel>(l));
+    return levels;
+}
+
+template <typename F>
+void BenchKernel(const char* name, size_t n, F&& kernel)
+{
+    double scalarNs = 0.0;
+    for (SimdLevel level : Levels())
+    {
+        double ns = NanosPerValue(n, [&] { kernel(level); });
+        if (level == SimdLevel::Scalar) scalarNs = ns;
+        Report(name, level, ns, scalarNs);
+    }
+}
+
+void BenchScan(const char* name, Table& table, const std::vector<Predicate>& filters)
+{
+    double scalarNs = 0.0;
+    for (SimdLevel level : Levels())
+    {
+        SetSimdLevel(level);
+        double ns = NanosPerValue(table.RowCount(), [&] {
+            SeqScanOp scan(table, 0, filters);
+            TupleBatch batch(1);
+            scan.Open();
+            while (scan.NextBatch(batch))
+                for (uint32_t pos : batch.sel) g_sink += batch.ids[0][pos];
+        });
+        if (level == SimdLevel::Scalar) scalarNs = ns;
+        Report(name, level, ns, scalarNs);
+    }
+    SetSimdLevel(DetectSimdLevel());
+}
+
+Predicate MakePredicate(const Table& table, const std::string& column, CompareOp op, json value)
+{
+    Predicate p;
+    p.column.column = column;
+    p.column.index = table.ColumnIndex(column);
+    p.op = op;
+    p.value = std::move(value);
+    return p;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : (size_t(1) << 20);
+    std::printf("values: %zu, detected: %s\n\n", n, SimdLevelName(DetectSimdLevel()));
+
+    std::mt19937_64 rng(42);
+    std::vector<int64_t> ints(n);
+    std::vector<double> doubles(n);
+    std::vector<uint32_t> codes(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        ints[i] = static_cast<int64_t>(rng() % 101);
+        doubles[i] = static_cast<double>(rng() % 4001) / 1000.0;
+        codes[i] = static_cast<uint32_t>(rng() % 16);
+    }
+    std::vector<uint64_t> bits((n + 63) / 64);
+
+    BenchKernel("FilterInt64 >= 80", n, [&](SimdLevel level) {
+        FilterInt64(ints.data(), n, CompareOp::GE, 80, bits.data(), level);
+        g_sink += Checksum(bits);
+    });
+    BenchKernel("FilterInt64 = 50", n, [&](SimdLevel level) {
+        FilterInt64(ints.data(), n, CompareOp::EQ, 50, bits.data(), level);
+        g_sink += Checksum(bits);
+    });
+    BenchKernel("FilterDouble < 2.5", n, [&](SimdLevel level) {
+        FilterDouble(doubles.data(), n, CompareOp::LT, 2.5, bits.data(), level);
+        g_sink += Checksum(bits);
+    });
+    BenchKernel("FilterCodesEqual", n, [&](SimdLevel level) {
+        FilterCodesEqual(codes.data(), n, 7, bits.data(), level);
+        g_sink += Checksum(bits);
+    });
+
+    // the same comparisons through SeqScan, including decoding packed INT row groups
+    Database db("bench");
+    Table& table = db.CreateTable("grades");
+    table.AddColumn(Attribute("id", DType::INT));
+    table.AddColumn(Attribute("score", DType::INT));
+    table.AddColumn(Attribute("gpa", DType::REAL));
+    table.AddColumn(Attribute("course", DType::TEXT));
+    size_t i = 0;
+    InsertBatch(table, [&](json& out) {
+        if (i >= n) return false;
+        out = {
+            {"id", static_cast<int64_t>(i)},
+            {"score", ints[i]},
+            {"gpa", doubles[i]},
+            {"course", "course" + std::to_string(codes[i])}
+        };
+        ++i;
+        return true;
+    }, n);
+
+    std::printf("\n");
+    BenchScan("SeqScan score >= 80", table, { MakePredicate(table, "score", CompareOp::GE, 80) });
+    BenchScan("SeqScan gpa < 2.5", table, { MakePredicate(table, "gpa", CompareOp::LT, 2.5) });
+    BenchScan("SeqScan course = \"course7\"", table, { MakePredicate(table, "course", CompareOp::EQ, "course7") });
+
+    std::printf("\n(checksum %llu)\n", static_cast<unsigned long long>(g_sink));
+    return 0;
+}
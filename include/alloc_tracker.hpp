@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+// Bytes requested through global operator new on the current thread.
+// The counting operators live in src/core/alloc_tracker.cpp; a binary that does not
+// link that file always reads zero here.
+inline thread_local uint64_t tl_allocatedBytes = 0;
+
+inline uint64_t ThreadAllocatedBytes()
+{
+    return tl_allocatedBytes;
+}
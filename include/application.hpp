@@ -2,20 +2,46 @@
 #include <memory>
 #include <string>
 
-#include <database.hpp>
+#include <query.hpp>
+#include <result_writer.hpp>
+
+struct ApplicationOptions
+{
+    std::string dbPath = "database.json";
+
+    // Non-interactive mode: run the statements in this file (one per line) without
+    // prompts, then print a throughput and latency summary
+    std::string scriptPath;
+    bool abortOnError = false;  // otherwise report the error and go on with the next line
+    std::string user;           // script login when the database has credentials
+
+    // Initial result format; FORMAT changes it for the rest of the session
+    OutputFormat format = OutputFormat::Table;
+};
 
 class Application
 {
 public:
-    Application();
+    explicit Application(ApplicationOptions options = {});
     ~Application();
 
     void Run();
 
+    // Non-zero when a script could not run or one of its statements failed
+    int ExitCode() const { return exitCode; }
+
 private:
+    ApplicationOptions options;
     bool running = false;
     bool authenticated = false;
+    bool aborted = false;
+    int exitCode = 0;
     std::shared_ptr<Database> db;
 
-    void PrintResult(const QueryResult& result);
+    bool Scripted() const { return !options.scriptPath.empty(); }
+    void LoginInteractive();
+    void LoginForScript();
+    void RunScript();
+    void ExecuteStatement(const std::string& input);
+    void PrintResult(QueryResult& result);
 };
@@ -10,8 +10,15 @@
 #include <algorithm>
 #include <cctype>
 #include <functional>
+#include <random>
+#include <cmath>
+#include <iterator>
+#include <atomic>
 
 #include <nlohmann/json.hpp>
+#include <statistics.hpp>
+#include <storage.hpp>
+#include <trace.hpp>
 
 using json = nlohmann::json;
 
@@ -59,6 +66,9 @@ struct Entity
     std::unordered_map<std::string, Value> fields;
 };
 
+// One row's values in schema order, as stored
+using RowValues = std::vector<json>;
+
 struct ForeignKey
 {
     std::string column;
@@ -66,26 +76,200 @@ struct ForeignKey
     std::string refColumn;
 };
 
+/* =======================
+   INDEXES
+   ======================= */
+
+// Hashes numbers by value so that 1 and 1.0 (which compare equal) share a bucket
+struct JsonKeyHash
+{
+    size_t operator()(const json& v) const
+    {
+        if (v.is_number())
+            return std::hash<double>{}(v.get<double>());
+        return std::hash<json>{}(v);
+    }
+};
+
+// Heap bytes a JSON key owns outside its own object (strings only; other keys used as
+// index keys are stored inline)
+inline size_t JsonKeyHeapBytes(const json& key)
+{
+    if (!key.is_string()) return 0;
+    const auto& s = key.get_ref<const std::string&>();
+    return sizeof(std::string) + (s.capacity() > 15 ? s.capacity() + 1 : 0);
+}
+
+// Hash index: column value -> row positions holding that value
+struct Index
+{
+    std::string column;
+    bool unique = false;
+    std::unordered_map<json, std::vector<size_t>, JsonKeyHash> entries;
+
+    // Kept current by Add and ApplyIndexKeyChanges for MeasureMemory
+    size_t bucketBytes = 0;   // capacity of every row id vector
+    size_t keyHeapBytes = 0;  // see JsonKeyHeapBytes
+
+    const std::vector<size_t>* Find(const json& key) const
+    {
+        auto it = entries.find(key);
+        return it == entries.end() ? nullptr : &it->second;
+    }
+
+    void Add(const json& key, size_t row)
+    {
+        auto [it, inserted] = entries.try_emplace(key);
+        if (inserted) keyHeapBytes += JsonKeyHeapBytes(it->first);
+        auto& bucket = it->second;
+        size_t before = bucket.capacity();
+        bucket.push_back(row);
+        bucketBytes += (bucket.capacity() - before) * sizeof(size_t);
+    }
+
+    // Hash table buckets and nodes (node = next pointer, cached hash, key, row id vector)
+    // plus what the keys and row id vectors hold
+    size_t MemoryBytes() const
+    {
+        constexpr size_t kNodeBytes = sizeof(void*) + sizeof(size_t) + sizeof(json) + sizeof(std::vector<size_t>);
+        return entries.bucket_count() * sizeof(void*) + entries.size() * kNodeBytes + bucketBytes + keyHeapBytes;
+    }
+};
+
 /* =======================
    TABLE
    ======================= */
 
+inline StorageKind StorageKindFor(DType t)
+{
+    switch (t)
+    {
+    case DType::TEXT:
+    case DType::CHAR: return StorageKind::String;
+    case DType::INT: return StorageKind::Int64;
+    case DType::FLOAT:
+    case DType::REAL: return StorageKind::Double;
+    case DType::RELATION: return StorageKind::Json;
+    }
+    return StorageKind::Json;
+}
+
+// Process-wide, so a version is never reused, not even by a table dropped and created
+// again under the same name or by a table of another Database
+inline uint64_t NextTableVersion()
+{
+    static std::atomic<uint64_t> next{ 1 };
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
 struct Table
 {
     std::string name;
     std::vector<Attribute> schema;
-    std::vector<Entity> rows;
     std::vector<ForeignKey> foreignKeys;
 
+    // Column-major row data; row ids are positions in this storage
+    TableStorage storage;
+
+    // column name -> position in `schema` / `storage`
+    std::unordered_map<std::string, size_t> columnIndex;
+
     // For columns declared AUTO_INCREMENT, track next available value
     std::unordered_map<std::string, int64_t> autoIncCounters;
 
+    // Per-column statistics gathered by ANALYZE (empty until analyzed)
+    TableStats stats;
+
+    // Hash indexes keyed by column name (primary keys are always indexed)
+    std::unordered_map<std::string, Index> indexes;
+
+    // Tombstones: bit i set = row i was removed but not yet compacted away.
+    // Index entries of removed rows also stay until compaction.
+    std::vector<uint64_t> deleted;
+    size_t deletedCount = 0;
+
+    // Changes whenever rows or columns do (Touch); results computed at one version stay
+    // valid while the table keeps it (see ResultCache)
+    uint64_t version = NextTableVersion();
+
     explicit Table(const std::string& n) : name(n) {}
 
+    void Touch() { version = NextTableVersion(); }
+
+    uint64_t DeletedWord(size_t word) const
+    {
+        return word < deleted.size() ? deleted[word] : 0;
+    }
+
+    bool IsDeleted(size_t row) const
+    {
+        return (DeletedWord(row >> 6) >> (row & 63)) & 1;
+    }
+
+    void MarkDeleted(size_t row)
+    {
+        if (IsDeleted(row)) return;
+        if ((row >> 6) >= deleted.size())
+            deleted.resize((RowCount() + 63) >> 6, 0);
+        deleted[row >> 6] |= uint64_t(1) << (row & 63);
+        ++deletedCount;
+    }
+
+    size_t RowCount() const { return storage.RowCount(); }
+    size_t LiveRowCount() const { return RowCount() - deletedCount; }
+
+    // True if an index bucket still refers to at least one row that is not deleted
+    bool AnyLive(const std::vector<size_t>* ids) const
+    {
+        if (!ids) return false;
+        if (deletedCount == 0) return !ids->empty();
+        return std::any_of(ids->begin(), ids->end(), [&](size_t r) { return !IsDeleted(r); });
+    }
+
     bool HasColumn(const std::string& col) const
     {
-        return std::any_of(schema.begin(), schema.end(),
-            [&](const Attribute& a) { return a.name == col; });
+        return columnIndex.count(col) != 0;
+    }
+
+    size_t ColumnIndex(const std::string& col) const
+    {
+        auto it = columnIndex.find(col);
+        if (it == columnIndex.end())
+            throw std::runtime_error("Unknown column: " + col);
+        return it->second;
+    }
+
+    void AddColumn(const Attribute& attr)
+    {
+        if (HasColumn(attr.name))
+            throw std::runtime_error("Duplicate column: " + attr.name);
+        storage.AddColumn(StorageKindFor(attr.type));
+        columnIndex[attr.name] = schema.size();
+        schema.push_back(attr);
+        Touch();
+    }
+
+    json GetValue(size_t row, size_t col) const { return storage.Get(row, col); }
+
+    json GetValue(size_t row, const std::string& col) const
+    {
+        return storage.Get(row, ColumnIndex(col));
+    }
+
+    // Materializes a stored row into the name-keyed form used by results
+    Entity GetRow(size_t row) const
+    {
+        Entity e;
+        e.fields.reserve(schema.size());
+        for (size_t c = 0; c < schema.size(); ++c)
+            e.fields.emplace(schema[c].name, Value(schema[c].type, storage.Get(row, c)));
+        return e;
+    }
+
+    const Index* FindIndex(const std::string& col) const
+    {
+        auto it = indexes.find(col);
+        return it == indexes.end() ? nullptr : &it->second;
     }
 };
 
@@ -105,6 +289,13 @@ public:
         return *table;
     }
 
+    // Dropping the last reference frees the table's storage pages
+    void DropTable(const std::string& tableName)
+    {
+        if (tables.erase(tableName) == 0)
+            throw std::runtime_error("Table not found: " + tableName);
+    }
+
     Table& GetTable(const std::string& tableName)
     {
         auto it = tables.find(tableName);
@@ -174,16 +365,88 @@ private:
    CORE OPERATIONS
    ======================= */
 
-inline void Insert(Table& table, const json& values)
+inline const char* DTypeName(DType t)
+{
+    switch (t)
+    {
+    case DType::TEXT: return "TEXT";
+    case DType::CHAR: return "CHAR";
+    case DType::INT: return "INT";
+    case DType::FLOAT: return "FLOAT";
+    case DType::REAL: return "REAL";
+    case DType::RELATION: return "RELATION";
+    }
+    return "?";
+}
+
+// Checks a value against the column type. Integral floats (3.0) are accepted for INT
+// and stored as integers; null is always accepted here (NOT NULL is checked separately).
+inline json CoerceValue(const Attribute& attr, const json& v)
 {
-    Entity row;
+    if (v.is_null()) return v;
+
+    bool ok = true;
+    switch (attr.type)
+    {
+    case DType::TEXT:
+    case DType::CHAR:
+        ok = v.is_string();
+        break;
+    case DType::INT:
+        if (v.is_number_float())
+        {
+            double d = v.get<double>();
+            if (d == std::floor(d) && std::abs(d) < 9.2e18)
+                return static_cast<int64_t>(d);
+            ok = false;
+        }
+        else ok = v.is_number_integer();
+        break;
+    case DType::FLOAT:
+    case DType::REAL:
+        ok = v.is_number();
+        break;
+    case DType::RELATION:
+        break;
+    }
+
+    if (!ok)
+        throw std::runtime_error("Type mismatch for column " + attr.name + ": expected "
+            + DTypeName(attr.type) + ", got " + v.dump());
+    return v;
+}
+
+// Turns one JSON object into a full row: explicit values are type-checked, missing
+// columns get AUTO_INCREMENT / DEFAULT / null. Does not touch the table's rows.
+inline RowValues BuildRow(Table& table, const json& values)
+{
+    if (!values.is_object())
+        throw std::runtime_error("Row must be a JSON object");
+
+    for (const auto& [key, v] : values.items())
+        if (!table.HasColumn(key))
+            throw std::runtime_error("Unknown column: " + key);
+
+    RowValues row;
+    row.reserve(table.schema.size());
 
     for (const auto& attr : table.schema)
     {
-        // Value provided explicitly
-        if (values.contains(attr.name))
+        // Value provided explicitly (an explicit null on AUTO_INCREMENT still generates)
+        if (values.contains(attr.name) && !(attr.isAutoIncrement && values.at(attr.name).is_null()))
         {
-            row.fields[attr.name] = Value(attr.type, values.at(attr.name));
+            json v = CoerceValue(attr, values.at(attr.name));
+            if (v.is_null() && attr.isNotNull)
+                throw std::runtime_error("Column cannot be null: " + attr.name);
+
+            // keep AUTO_INCREMENT ahead of explicitly supplied values
+            if (attr.isAutoIncrement && v.is_number_integer())
+            {
+                auto& counter = table.autoIncCounters[attr.name];
+                counter = std::max(counter, v.get<int64_t>() + 1);
+            }
+
+            row.push_back(std::move(v));
             continue;
         }
 
@@ -192,7 +455,7 @@ inline void Insert(Table& table, const json& values)
         {
             auto& counter = table.autoIncCounters[attr.name];
             if (counter == 0) counter = 1; // start from 1
-            row.fields[attr.name] = Value(attr.type, counter);
+            row.push_back(counter);
             counter++;
             continue;
         }
@@ -200,7 +463,7 @@ inline void Insert(Table& table, const json& values)
         // DEFAULT provided
         if (attr.hasDefault)
         {
-            row.fields[attr.name] = Value(attr.type, attr.defaultValue);
+            row.push_back(attr.defaultValue);
             continue;
         }
 
@@ -209,322 +472,557 @@ inline void Insert(Table& table, const json& values)
             throw std::runtime_error("Missing column: " + attr.name);
 
         // otherwise insert null
-        row.fields[attr.name] = Value(attr.type, json());
+        row.push_back(json());
     }
 
-    // Enforce primary key uniqueness (simple single-column keys)
-    for (const auto& attr : table.schema)
+    return row;
+}
+
+// Enforces primary key uniqueness (simple single-column keys) for a batch of new rows,
+// both against the table and within the batch
+inline void CheckPrimaryKeys(const Table& table, const std::vector<RowValues>& rows)
+{
+    TRACE_SPAN("CheckPrimaryKeys");
+    for (size_t c = 0; c < table.schema.size(); ++c)
     {
+        const auto& attr = table.schema[c];
         if (!attr.isPrimaryKey) continue;
         const auto& key = attr.name;
-        const auto& val = row.fields.at(key).data;
-        for (const auto& existing : table.rows)
+        const Index* idx = table.FindIndex(key);
+
+        std::unordered_map<json, size_t, JsonKeyHash> seen;
+        seen.reserve(rows.size());
+        for (const auto& row : rows)
         {
-            if (existing.fields.at(key).data == val)
+            const auto& val = row[c];
+            if (!seen.emplace(val, 0).second)
                 throw std::runtime_error("Duplicate primary key: " + key);
+
+            if (idx)
+            {
+                if (table.AnyLive(idx->Find(val)))
+                    throw std::runtime_error("Duplicate primary key: " + key);
+                continue;
+            }
+
+            for (size_t i = 0; i < table.RowCount(); ++i)
+            {
+                if (!table.IsDeleted(i) && table.GetValue(i, c) == val)
+                    throw std::runtime_error("Duplicate primary key: " + key);
+            }
         }
     }
-
-    table.rows.push_back(row);
 }
 
-inline std::vector<Entity> Select(
-    const Table& table,
-    const std::string& column,
-    const json& value)
+// Appends already validated rows and adds them to every index in one pass per index
+inline void AppendRows(Table& table, std::vector<RowValues>&& rows)
 {
-    std::vector<Entity> result;
+    TRACE_SPAN("AppendRows");
+    size_t base = table.RowCount();
 
-    for (const auto& row : table.rows)
+    for (auto& [col, idx] : table.indexes)
     {
-        if (row.fields.at(column).data == value)
-            result.push_back(row);
+        size_t c = table.ColumnIndex(col);
+        idx.entries.reserve(idx.entries.size() + rows.size());
+        for (size_t i = 0; i < rows.size(); ++i)
+            idx.Add(rows[i][c], base + i);
     }
 
-    return result;
+    for (const auto& row : rows)
+        table.storage.AppendRow(row);
+    table.Touch();
 }
 
-inline bool ValidateForeignKeys(
-    const Table& table,
-    const Database& db)
+inline void Insert(Table& table, const json& values)
 {
-    for (const auto& fk : table.foreignKeys)
-    {
-        const auto& refTable = db.GetTable(fk.refTable);
+    std::vector<RowValues> rows;
+    rows.push_back(BuildRow(table, values));
+    CheckPrimaryKeys(table, rows);
+    AppendRows(table, std::move(rows));
+}
 
-        for (const auto& row : table.rows)
-        {
-            const auto& val = row.fields.at(fk.column).data;
+// Builds and validates every row before applying any of them, so a failing row leaves
+// the table (and its AUTO_INCREMENT counters) untouched. `next(json&)` yields the input
+// objects one at a time and returns false when exhausted; `expected` is a size hint.
+template <typename NextFn>
+inline size_t InsertBatch(Table& table, NextFn&& next, size_t expected = 0)
+{
+    auto savedCounters = table.autoIncCounters;
+    std::vector<RowValues> rows;
+    rows.reserve(expected);
 
-            bool found = false;
-            for (const auto& refRow : refTable.rows)
+    try
+    {
+        TRACE_SPAN("BuildRows");
+        json values;
+        while (next(values))
+        {
+            try { rows.push_back(BuildRow(table, values)); }
+            catch (const std::exception& e)
             {
-                if (refRow.fields.at(fk.refColumn).data == val)
-                {
-                    found = true;
-                    break;
-                }
+                throw std::runtime_error("Row " + std::to_string(rows.size() + 1) + ": " + e.what());
             }
-
-            if (!found)
-                return false;
         }
+        CheckPrimaryKeys(table, rows);
     }
-    return true;
+    catch (...)
+    {
+        table.autoIncCounters = std::move(savedCounters);
+        throw;
+    }
+
+    size_t n = rows.size();
+    AppendRows(table, std::move(rows));
+    return n;
 }
 
-/* =======================
-   QUERY SYSTEM
-   ======================= */
+// Batch insert from an in-memory JSON array of objects
+inline size_t InsertArray(Table& table, const json& array)
+{
+    if (!array.is_array())
+        throw std::runtime_error("Batch insert requires a JSON array");
+
+    size_t i = 0;
+    return InsertBatch(table, [&](json& out) {
+        if (i >= array.size()) return false;
+        out = array[i++];
+        return true;
+    }, array.size());
+}
 
-struct QueryResult
+// Builds (or rebuilds) the hash index on `column` from the current rows
+inline void CreateIndex(Table& table, const std::string& column)
 {
-    bool hasResult = false;
-    std::vector<Entity> rows;
+    if (!table.HasColumn(column))
+        throw std::runtime_error("Unknown column: " + column);
+
+    size_t c = table.ColumnIndex(column);
+    Index idx;
+    idx.column = column;
+    idx.unique = table.schema[c].isPrimaryKey;
+
+    for (size_t i = 0; i < table.RowCount(); ++i)
+        if (!table.IsDeleted(i))
+            idx.Add(table.GetValue(i, c), i);
+
+    table.indexes[column] = std::move(idx);
+}
+
+// Moves row ids between index buckets after their key changed. Removals are grouped
+// per old key so each affected bucket is filtered once, whatever its size.
+struct IndexKeyChange
+{
+    size_t row;
+    json oldKey;
+    json newKey;
 };
 
-inline std::vector<std::string> Tokenize(const std::string& q)
+inline void ApplyIndexKeyChanges(Index& idx, const std::vector<IndexKeyChange>& changes)
 {
-    std::stringstream ss(q);
-    std::string tok;
-    std::vector<std::string> tokens;
+    std::unordered_map<json, std::vector<size_t>, JsonKeyHash> removals;
+    for (const auto& c : changes)
+        removals[c.oldKey].push_back(c.row);
 
-    while (ss >> tok)
-        tokens.push_back(tok);
+    for (auto& [key, rowsToRemove] : removals)
+    {
+        auto it = idx.entries.find(key);
+        if (it == idx.entries.end()) continue;
+
+        std::sort(rowsToRemove.begin(), rowsToRemove.end());
+        auto& bucket = it->second;
+        bucket.erase(std::remove_if(bucket.begin(), bucket.end(),
+            [&](size_t r) { return std::binary_search(rowsToRemove.begin(), rowsToRemove.end(), r); }),
+            bucket.end());
+        if (bucket.empty())
+        {
+            idx.bucketBytes -= bucket.capacity() * sizeof(size_t);
+            idx.keyHeapBytes -= JsonKeyHeapBytes(it->first);
+            idx.entries.erase(it);
+        }
+    }
 
-    return tokens;
+    for (const auto& c : changes)
+        idx.Add(c.newKey, c.row);
 }
 
-inline QueryResult ExecuteQuery(Database& db, const std::string& query)
+// Row positions shift when rows are erased; re-derive every index afterwards
+inline void RebuildIndexes(Table& table)
 {
-    auto tokens = Tokenize(query);
+    std::vector<std::string> columns;
+    for (const auto& [col, idx] : table.indexes)
+        columns.push_back(col);
+    for (const auto& col : columns)
+        CreateIndex(table, col);
+}
 
-    if (tokens.empty())
-        throw std::runtime_error("Empty query");
+// Tombstones a row; storage and index entries are reclaimed by CompactTable
+inline void RemoveRow(Table& table, size_t row)
+{
+    table.MarkDeleted(row);
+}
+
+// Copies the live rows into fresh storage and rebuilds the indexes. The old storage
+// (including every string slot freed by tombstoned rows) goes back to the OS at once.
+inline void CompactTable(Table& table)
+{
+    if (table.deletedCount == 0) return;
 
-    /* -------- CREATE --------
-       CREATE TABLE Name (col TYPE, ...)
-    */
-    if (tokens[0] == "CREATE")
+    // keep each column's encoding so a column that outgrew its dictionary is not re-encoded;
+    // INT row groups unpacked by updates are packed again as they are copied
+    TableStorage fresh;
+    for (size_t c = 0; c < table.schema.size(); ++c)
     {
-        if (tokens.size() < 3 || tokens[1] != "TABLE")
-            throw std::runtime_error("Invalid CREATE syntax");
+        const auto& col = table.storage.Column(c);
+        fresh.AddColumn(col.kind, col.dictionary || col.packed);
+    }
+    for (size_t i = 0; i < table.RowCount(); ++i)
+        if (!table.IsDeleted(i)) fresh.AppendRowFrom(table.storage, i);
+    table.storage = std::move(fresh);
+
+    table.deleted.clear();
+    table.deleted.shrink_to_fit();
+    table.deletedCount = 0;
+    table.Touch();
+    RebuildIndexes(table);
+}
 
-        auto parenStart = query.find('(');
-        auto parenEnd = query.rfind(')');
-        if (parenStart == std::string::npos || parenEnd == std::string::npos || parenEnd < parenStart)
-            throw std::runtime_error("CREATE TABLE requires column definitions in parentheses");
+// Compact once enough of the table is dead that skipping it costs more than rebuilding
+constexpr size_t kCompactionMinDeleted = 1024;
+constexpr double kCompactionDeletedRatio = 0.25;
 
-        std::string tableName = tokens[2];
+inline bool MaybeCompact(Table& table)
+{
+    bool allDead = table.deletedCount > 0 && table.deletedCount == table.RowCount();
+    bool enough = table.deletedCount >= kCompactionMinDeleted
+        && static_cast<double>(table.deletedCount) >= kCompactionDeletedRatio * static_cast<double>(table.RowCount());
+    if (!allDead && !enough) return false;
+    CompactTable(table);
+    return true;
+}
 
-        if (db.GetTables().find(tableName) != db.GetTables().end())
-            throw std::runtime_error("Table already exists: " + tableName);
+// Gathers per-column statistics. Null counts, min/max and the distinct estimate
+// cover every row; histogram and most-common values come from a fixed-size sample.
+inline void Analyze(Table& table)
+{
+    TableStats stats;
+    stats.analyzed = true;
+    stats.rowCount = table.LiveRowCount();
+
+    // deterministic reservoir sample of live row positions, shared by all columns
+    std::vector<size_t> sample;
+    std::mt19937_64 rng(0x5eed);
+    size_t seen = 0;
+    for (size_t i = 0; i < table.RowCount(); ++i)
+    {
+        if (table.IsDeleted(i)) continue;
+        if (sample.size() < kStatsSampleSize)
+            sample.push_back(i);
+        else
+        {
+            size_t j = std::uniform_int_distribution<size_t>(0, seen)(rng);
+            if (j < kStatsSampleSize) sample[j] = i;
+        }
+        ++seen;
+    }
 
-        auto& table = db.CreateTable(tableName);
+    for (size_t c = 0; c < table.schema.size(); ++c)
+    {
+        const auto& attr = table.schema[c];
+        ColumnStats cs;
+        cs.rowCount = stats.rowCount;
+        HyperLogLog hll;
 
-        auto colsText = query.substr(parenStart + 1, parenEnd - parenStart - 1);
-        std::stringstream ss(colsText);
-        std::string colDef;
-        while (std::getline(ss, colDef, ','))
+        for (size_t i = 0; i < table.RowCount(); ++i)
         {
-            auto l = colDef.find_first_not_of(" \t\n\r");
-            auto r = colDef.find_last_not_of(" \t\n\r");
-            if (l == std::string::npos) continue;
-            std::string def = colDef.substr(l, r - l + 1);
-
-            std::stringstream ds(def);
-            std::string colName, typeStr;
-            ds >> colName >> typeStr;
-            if (colName.empty() || typeStr.empty())
-                throw std::runtime_error("Invalid column definition: " + def);
-
-            // remainder contains modifiers like PRIMARY KEY, AUTO_INCREMENT, NOT NULL, DEFAULT ...
-            auto posAfterType = def.find(typeStr);
-            std::string modifiers = "";
-            if (posAfterType != std::string::npos)
-                modifiers = def.substr(posAfterType + typeStr.size());
-
-            std::transform(typeStr.begin(), typeStr.end(), typeStr.begin(), ::toupper);
-
-            DType dtype;
-            if (typeStr == "TEXT") dtype = DType::TEXT;
-            else if (typeStr == "CHAR") dtype = DType::CHAR;
-            else if (typeStr == "INT") dtype = DType::INT;
-            else if (typeStr == "FLOAT") dtype = DType::FLOAT;
-            else if (typeStr == "REAL") dtype = DType::REAL;
-            else if (typeStr == "RELATION") dtype = DType::RELATION;
-            else throw std::runtime_error("Unknown type: " + typeStr);
-
-            Attribute attr(colName, dtype);
-
-            // parse modifiers (case-insensitive)
-            std::string up = modifiers;
-            std::transform(up.begin(), up.end(), up.begin(), ::toupper);
-
-            if (up.find("AUTO") != std::string::npos)
-                attr.isAutoIncrement = true;
-            if (up.find("PRIMARY") != std::string::npos && up.find("KEY") != std::string::npos)
-                attr.isPrimaryKey = true;
-            if (up.find("NOT") != std::string::npos && up.find("NULL") != std::string::npos)
-                attr.isNotNull = true;
-
-            // DEFAULT parsing: find 'DEFAULT' and extract the following token (allow quoted strings)
-            auto defPos = up.find("DEFAULT");
-            if (defPos != std::string::npos)
+            if (table.IsDeleted(i)) continue;
+            json v = table.GetValue(i, c);
+            if (v.is_null())
             {
-                // find original 'DEFAULT' position in modifiers to get original-case token
-                auto origDefPos = modifiers.find_first_of("DEFAULT");
-                if (origDefPos == std::string::npos) origDefPos = defPos; // fallback
-                size_t vpos = origDefPos + 7; // length of DEFAULT
-                // skip whitespace
-                while (vpos < modifiers.size() && isspace((unsigned char)modifiers[vpos])) ++vpos;
-                if (vpos < modifiers.size())
-                {
-                    if (modifiers[vpos] == '"')
-                    {
-                        size_t endq = modifiers.find('"', vpos + 1);
-                        if (endq == std::string::npos) throw std::runtime_error("Unterminated DEFAULT string in: " + def);
-                        std::string dv = modifiers.substr(vpos + 1, endq - vpos - 1);
-                        attr.hasDefault = true;
-                        attr.defaultValue = dv;
-                    }
-                    else
-                    {
-                        // read until space or end
-                        size_t endv = vpos;
-                        while (endv < modifiers.size() && !isspace((unsigned char)modifiers[endv])) ++endv;
-                        std::string dv = modifiers.substr(vpos, endv - vpos);
-                        // try to parse as json (numbers, booleans), fall back to string
-                        try { attr.defaultValue = json::parse(dv); }
-                        catch (...) { attr.defaultValue = dv; }
-                        attr.hasDefault = true;
-                    }
-                }
+                ++cs.nullCount;
+                continue;
             }
+            hll.Add(HyperLogLog::HashValue(v));
+            if (cs.min.is_null() || v < cs.min) cs.min = v;
+            if (cs.max.is_null() || cs.max < v) cs.max = v;
+        }
 
-            table.schema.push_back(attr);
+        if (cs.rowCount > 0)
+        {
+            cs.nullFraction = static_cast<double>(cs.nullCount) / static_cast<double>(cs.rowCount);
+            // the sketch never reports more distinct values than there are non-null rows
+            cs.distinct = std::min(hll.Estimate(), static_cast<double>(cs.rowCount - cs.nullCount));
+        }
 
-            if (attr.isAutoIncrement)
-                table.autoIncCounters[attr.name] = 1; // initialize counter
+        std::vector<json> values;
+        values.reserve(sample.size());
+        for (size_t i : sample)
+        {
+            json v = table.GetValue(i, c);
+            if (!v.is_null()) values.push_back(std::move(v));
         }
+        BuildDistribution(cs, std::move(values), sample.size());
 
-        return {};
+        stats.columns[attr.name] = std::move(cs);
     }
 
-    /* -------- INSERT --------
-       INSERT TableName {json}
-    */
-    if (tokens[0] == "INSERT")
-    {
-        if (tokens.size() < 2)
-            throw std::runtime_error("Invalid INSERT syntax");
-
-        auto jsonStart = query.find('{');
-        auto jsonEnd   = query.rfind('}');
-
-        if (jsonStart == std::string::npos || jsonEnd == std::string::npos)
-            throw std::runtime_error("INSERT requires JSON object");
+    table.stats = std::move(stats);
+}
 
-        auto jsonText = query.substr(jsonStart, jsonEnd - jsonStart + 1);
-        json values = json::parse(jsonText);
+// Memory held by a table's row storage versus the bytes its live rows actually need.
+// Dead rows, partly filled row groups, page tails, string slot rounding and free-listed
+// slots all count as overhead. RELATION values live outside the arenas and are ignored.
+struct StorageUsage
+{
+    size_t pages = 0;
+    size_t reservedBytes = 0;
+    size_t liveBytes = 0;
+    size_t freeListBytes = 0;
 
-        Insert(db.GetTable(tokens[1]), values);
-        return {};
+    // reserved / live: 1.0 means no waste; 0 for a table without live data
+    double Fragmentation() const
+    {
+        return liveBytes ? static_cast<double>(reservedBytes) / static_cast<double>(liveBytes) : 0.0;
     }
+};
 
-    /* -------- SELECT --------
-       SELECT Table
-       SELECT Table WHERE col = value
-    */
-    if (tokens[0] == "SELECT")
+inline StorageUsage MeasureStorage(const Table& table)
+{
+    const auto& st = table.storage;
+    StorageUsage u;
+    u.pages = st.ValueArena().PageCount() + st.Strings().PageCount();
+    u.reservedBytes = st.ValueArena().ReservedBytes() + st.Strings().ReservedBytes();
+    u.freeListBytes = st.Strings().FreeListBytes();
+
+    size_t live = table.LiveRowCount();
+    for (size_t c = 0; c < st.ColumnCount(); ++c)
     {
-        if (tokens.size() < 2)
-            throw std::runtime_error("Invalid SELECT syntax");
-
-        QueryResult result;
-        result.hasResult = true;
-
-        const auto& table = db.GetTable(tokens[1]);
-
-        if (tokens.size() == 2)
+        // a packed INT row group needs only its encoded bytes
+        if (st.Kind(c) == StorageKind::Int64)
         {
-            result.rows = table.rows;
-            return result;
+            for (size_t g = 0; g < st.GroupCount(); ++g)
+            {
+                const ColumnChunk& chunk = st.Chunk(g, c);
+                if (chunk.encoding != IntEncoding::Plain)
+                {
+                    u.liveBytes += PackedSizeBytes(static_cast<const PackedInts*>(chunk.values));
+                    continue;
+                }
+                size_t end = std::min(st.RowCount(), (g + 1) * kRowGroupSize);
+                for (size_t r = g * kRowGroupSize; r < end; ++r)
+                    if (!table.IsDeleted(r)) u.liveBytes += sizeof(int64_t);
+            }
+            continue;
         }
 
-        if (tokens.size() >= 6 && tokens[2] == "WHERE" && tokens[4] == "=")
+        u.liveBytes += live * st.ValueWidth(c);
+        if (st.Kind(c) != StorageKind::String) continue;
+
+        // a dictionary holds each distinct string once
+        if (st.Column(c).dictionary)
         {
-            json value;
-            if (tokens[5].front() == '"')
-                value = tokens[5].substr(1, tokens[5].size() - 2);
-            else
-                value = json::parse(tokens[5]);
-
-            result.rows = Select(table, tokens[3], value);
-            return result;
+            for (const auto& slot : st.Column(c).dict)
+                u.liveBytes += slot.size;
+            continue;
         }
-
-        throw std::runtime_error("Invalid SELECT syntax");
+        for (size_t r = 0; r < st.RowCount(); ++r)
+            if (!table.IsDeleted(r) && !st.IsNull(r, c))
+                u.liveBytes += st.GetString(r, c).size();
     }
+    return u;
+}
+
+// Where a table's memory goes, from counters the arenas, string pool and indexes keep as
+// rows are inserted, updated, removed and compacted, so no rows are read. Removed rows
+// keep their share of row and string storage until compaction; that share is reported
+// as tombstone bytes, estimated from the fraction of rows removed. RELATION values count
+// their JSON slots only.
+struct MemoryUsage
+{
+    size_t rowBytes = 0;        // fixed-width values, null bitmaps, chunk descriptors
+    size_t stringBytes = 0;     // text payload and dictionaries
+    size_t indexBytes = 0;
+    size_t tombstoneBytes = 0;  // deleted-row bitmap plus the storage removed rows still hold
+    size_t overheadBytes = 0;   // reserved but unused arena space, string slot rounding, free lists
+
+    size_t Total() const { return rowBytes + stringBytes + indexBytes + tombstoneBytes + overheadBytes; }
+};
+
+inline MemoryUsage MeasureMemory(const Table& table)
+{
+    const auto& st = table.storage;
+    const Arena& arena = st.ValueArena();
+    const StringPool& strings = st.Strings();
 
-    /* -------- REMOVE --------
-       REMOVE Table
-       REMOVE Table WHERE col = value
-    */
-    if (tokens[0] == "REMOVE")
+    size_t rows = arena.UsedBytes();
+    size_t text = strings.PayloadBytes();
+    for (size_t c = 0; c < st.ColumnCount(); ++c)
     {
-        if (tokens.size() < 2)
-            throw std::runtime_error("Invalid REMOVE syntax");
+        const ColumnData& col = st.Column(c);
+        rows += col.chunks.capacity() * sizeof(ColumnChunk) + col.jsonValues.capacity() * sizeof(json);
+        text += col.dict.capacity() * sizeof(StringSlot)
+            + col.dictCodes.bucket_count() * sizeof(void*)
+            + col.dictCodes.size() * (sizeof(void*) + sizeof(size_t) + sizeof(std::string_view) + sizeof(uint32_t));
+    }
 
-        QueryResult result;
-        result.hasResult = true;
+    MemoryUsage u;
+    double dead = table.RowCount() ? static_cast<double>(table.deletedCount) / static_cast<double>(table.RowCount()) : 0.0;
+    size_t deadRows = static_cast<size_t>(static_cast<double>(rows) * dead);
+    size_t deadText = static_cast<size_t>(static_cast<double>(text) * dead);
+    u.rowBytes = rows - deadRows;
+    u.stringBytes = text - deadText;
+    u.tombstoneBytes = table.deleted.capacity() * sizeof(uint64_t) + deadRows + deadText;
+    u.overheadBytes = (arena.ReservedBytes() - arena.UsedBytes()) + (strings.ReservedBytes() - strings.PayloadBytes());
+    for (const auto& [col, idx] : table.indexes)
+        u.indexBytes += idx.MemoryBytes();
+    return u;
+}
 
-        auto& table = db.GetTable(tokens[1]);
+inline bool ValidateForeignKeys(
+    const Table& table,
+    const Database& db)
+{
+    for (const auto& fk : table.foreignKeys)
+    {
+        const auto& refTable = db.GetTable(fk.refTable);
+        size_t col = table.ColumnIndex(fk.column);
+        size_t refCol = refTable.ColumnIndex(fk.refColumn);
 
-        // Remove all rows
-        if (tokens.size() == 2)
+        for (size_t i = 0; i < table.RowCount(); ++i)
         {
-            result.rows = table.rows;
-            table.rows.clear();
-            return result;
-        }
+            if (table.IsDeleted(i)) continue;
+            json val = table.GetValue(i, col);
 
-        if (tokens.size() >= 6 && tokens[2] == "WHERE" && tokens[4] == "=")
-        {
-            json value;
-            if (tokens[5].front() == '"')
-                value = tokens[5].substr(1, tokens[5].size() - 2);
-            else
-                value = json::parse(tokens[5]);
-
-            // remove matching rows
-            std::vector<Entity> removed;
-            auto& rows = table.rows;
-            auto it = rows.begin();
-            while (it != rows.end())
+            bool found = false;
+            for (size_t r = 0; r < refTable.RowCount(); ++r)
             {
-                if (it->fields.at(tokens[3]).data == value)
+                if (!refTable.IsDeleted(r) && refTable.GetValue(r, refCol) == val)
                 {
-                    removed.push_back(*it);
-                    it = rows.erase(it);
+                    found = true;
+                    break;
                 }
-                else ++it;
             }
 
-            result.rows = removed;
-            return result;
+            if (!found)
+                return false;
         }
-
-        throw std::runtime_error("Invalid REMOVE syntax");
     }
-
-    throw std::runtime_error("Unknown command: " + tokens[0]);
+    return true;
 }
 
 /* =======================
    SERIALIZATION
    ======================= */
 
+inline std::string Base64Encode(const void* data, size_t size)
+{
+    static const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const auto* p = static_cast<const unsigned char*>(data);
+    std::string out;
+    out.reserve((size + 2) / 3 * 4);
+    for (size_t i = 0; i < size; i += 3)
+    {
+        uint32_t n = uint32_t(p[i]) << 16;
+        if (i + 1 < size) n |= uint32_t(p[i + 1]) << 8;
+        if (i + 2 < size) n |= p[i + 2];
+        out += alphabet[(n >> 18) & 63];
+        out += alphabet[(n >> 12) & 63];
+        out += i + 1 < size ? alphabet[(n >> 6) & 63] : '=';
+        out += i + 2 < size ? alphabet[n & 63] : '=';
+    }
+    return out;
+}
+
+inline std::vector<unsigned char> Base64Decode(const std::string& text)
+{
+    auto digit = [](char ch) -> int {
+        if (ch >= 'A' && ch <= 'Z') return ch - 'A';
+        if (ch >= 'a' && ch <= 'z') return ch - 'a' + 26;
+        if (ch >= '0' && ch <= '9') return ch - '0' + 52;
+        if (ch == '+') return 62;
+        if (ch == '/') return 63;
+        return -1;
+    };
+
+    std::vector<unsigned char> out;
+    out.reserve(text.size() / 4 * 3);
+    uint32_t n = 0;
+    int bits = 0;
+    for (char ch : text)
+    {
+        if (ch == '=') break;
+        int d = digit(ch);
+        if (d < 0) throw std::runtime_error("Invalid base64 data");
+        n = (n << 6) | static_cast<uint32_t>(d);
+        bits += 6;
+        if (bits >= 8)
+        {
+            bits -= 8;
+            out.push_back(static_cast<unsigned char>((n >> bits) & 0xff));
+        }
+    }
+    return out;
+}
+
+// Live values of an INT column as base64 PackedInts blocks of kRowGroupSize values.
+// Null rows are listed by position and hold their predecessor's value in the blocks.
+inline json SerializePackedColumn(const Table& table, size_t col)
+{
+    json segments = json::array();
+    json nulls = json::array();
+    std::vector<int64_t> block;
+    block.reserve(kRowGroupSize);
+    int64_t last = 0;
+    size_t pos = 0;
+
+    auto flush = [&] {
+        auto words = EncodeInts(block.data(), block.size());
+        segments.push_back(Base64Encode(words.data(), PackedSizeBytes(reinterpret_cast<const PackedInts*>(words.data()))));
+        block.clear();
+    };
+
+    for (size_t i = 0; i < table.RowCount(); ++i)
+    {
+        if (table.IsDeleted(i)) continue;
+        if (table.storage.IsNull(i, col)) nulls.push_back(pos);
+        else last = table.storage.GetInt(i, col);
+        block.push_back(last);
+        ++pos;
+        if (block.size() == kRowGroupSize) flush();
+    }
+    if (!block.empty()) flush();
+
+    json j = { {"segments", std::move(segments)} };
+    if (!nulls.empty()) j["nulls"] = std::move(nulls);
+    return j;
+}
+
+inline std::vector<json> DeserializePackedColumn(const json& j)
+{
+    std::vector<json> values;
+    for (const auto& seg : j.at("segments"))
+    {
+        auto bytes = Base64Decode(seg.get<std::string>());
+        if (bytes.size() < sizeof(PackedInts) || bytes.size() % sizeof(uint64_t) != 0)
+            throw std::runtime_error("Truncated packed column segment");
+
+        // copy into words so the header and payload are aligned
+        std::vector<uint64_t> words(bytes.size() / sizeof(uint64_t));
+        std::memcpy(words.data(), bytes.data(), words.size() * sizeof(uint64_t));
+        const auto* block = reinterpret_cast<const PackedInts*>(words.data());
+        if (PackedSizeBytes(block) > words.size() * sizeof(uint64_t))
+            throw std::runtime_error("Truncated packed column segment");
+
+        std::vector<int64_t> decoded(block->count);
+        DecodeInts(block, decoded.data());
+        values.insert(values.end(), decoded.begin(), decoded.end());
+    }
+
+    if (j.contains("nulls"))
+        for (const auto& pos : j["nulls"])
+            values.at(pos.get<size_t>()) = json();
+    return values;
+}
+
 inline json Serialize(const Database& db)
 {
     json j;
@@ -546,14 +1044,30 @@ inline json Serialize(const Database& db)
             jt["schema"].push_back(aj);
         }
 
-        for (const auto& row : table->rows)
+        // INT columns are written as packed segments instead of one field per row
+        std::vector<bool> packed(table->schema.size());
+        for (size_t c = 0; c < table->schema.size(); ++c)
+            packed[c] = table->storage.Column(c).packed && table->LiveRowCount() > 0;
+
+        for (size_t i = 0; i < table->RowCount(); ++i)
         {
-            json jr;
-            for (const auto& [k, v] : row.fields)
-                jr[k] = v.data;
-            jt["rows"].push_back(jr);
+            if (table->IsDeleted(i)) continue;
+            json jr = json::object();
+            for (size_t c = 0; c < table->schema.size(); ++c)
+                if (!packed[c]) jr[table->schema[c].name] = table->GetValue(i, c);
+            jt["rows"].push_back(std::move(jr));
         }
 
+        for (size_t c = 0; c < table->schema.size(); ++c)
+            if (packed[c]) jt["packed"][table->schema[c].name] = SerializePackedColumn(*table, c);
+
+        // primary-key indexes are implied by the schema; persist the others
+        for (const auto& [col, idx] : table->indexes)
+            if (!idx.unique) jt["indexes"].push_back(col);
+
+        if (table->stats.analyzed)
+            jt["stats"] = StatsToJson(table->stats);
+
         j[name] = jt;
     }
 
@@ -585,6 +1099,7 @@ inline void Deserialize(Database& db, const json& j)
     {
         if (tableName == "__meta") continue; // skip metadata
 
+        TRACE_SPAN_ARG("Deserialize table", tableName);
         auto& table = db.CreateTable(tableName);
 
         if (tableData.contains("schema"))
@@ -599,49 +1114,93 @@ inline void Deserialize(Database& db, const json& j)
                 if (attr.contains("auto")) a.isAutoIncrement = attr["auto"].get<bool>();
                 if (attr.contains("not_null")) a.isNotNull = attr["not_null"].get<bool>();
                 if (attr.contains("default")) { a.hasDefault = true; a.defaultValue = attr["default"]; }
-                table.schema.push_back(a);
+                table.AddColumn(a);
                 if (a.isAutoIncrement) table.autoIncCounters[a.name] = 1;
+                if (a.isPrimaryKey) CreateIndex(table, a.name);
             }
         }
 
         if (tableData.contains("rows"))
         {
-            for (const auto& row : tableData["rows"])
-            {
-                Insert(table, row);
-            }
+            const auto& rows = tableData["rows"];
+            if (!rows.is_array())
+                throw std::runtime_error("Rows of table " + tableName + " must be a JSON array");
+
+            // merge packed INT columns back into the row objects as they are inserted
+            std::vector<std::pair<std::string, std::vector<json>>> packed;
+            if (tableData.contains("packed"))
+                for (const auto& [col, pj] : tableData["packed"].items())
+                {
+                    packed.emplace_back(col, DeserializePackedColumn(pj));
+                    if (packed.back().second.size() != rows.size())
+                        throw std::runtime_error("Packed column " + col + " of table " + tableName + " does not match its rows");
+                }
+
+            size_t i = 0;
+            InsertBatch(table, [&](json& out) {
+                if (i >= rows.size()) return false;
+                out = rows[i];
+                for (const auto& [col, values] : packed)
+                    out[col] = values[i];
+                ++i;
+                return true;
+            }, rows.size());
 
             // adjust auto-increment counters based on max existing values
-            for (const auto& a : table.schema)
+            TRACE_SPAN("RecomputeAutoIncrement");
+            for (size_t c = 0; c < table.schema.size(); ++c)
             {
+                const auto& a = table.schema[c];
                 if (!a.isAutoIncrement) continue;
                 int64_t maxv = 0;
-                for (const auto& r : table.rows)
+                for (size_t r = 0; r < table.RowCount(); ++r)
                 {
-                    auto it = r.fields.find(a.name);
-                    if (it == r.fields.end()) continue;
-                    if (it->second.data.is_number())
-                    {
-                        int64_t v = it->second.data.get<int64_t>();
-                        if (v > maxv) maxv = v;
-                    }
+                    json v = table.GetValue(r, c);
+                    if (v.is_number() && v.get<int64_t>() > maxv) maxv = v.get<int64_t>();
                 }
                 table.autoIncCounters[a.name] = maxv + 1;
             }
         }
+
+        if (tableData.contains("indexes"))
+        {
+            TRACE_SPAN("CreateIndexes");
+            for (const auto& col : tableData["indexes"])
+                CreateIndex(table, col.get<std::string>());
+        }
+
+        if (tableData.contains("stats"))
+            table.stats = StatsFromJson(tableData["stats"]);
     }
 }
 
 inline void SaveToFile(const Database& db, const std::string& path)
 {
+    TRACE_SPAN_ARG("SaveToFile", path);
+    json j;
+    {
+        TRACE_SPAN("Serialize");
+        j = Serialize(db);
+    }
+    std::string text;
+    {
+        TRACE_SPAN("json::dump");
+        text = j.dump(4);
+    }
+    TRACE_SPAN("write");
     std::ofstream file(path);
-    file << Serialize(db).dump(4);
+    file << text;
 }
 
 inline void LoadFromFile(Database& db, const std::string& path)
 {
+    TRACE_SPAN_ARG("LoadFromFile", path);
     std::ifstream file(path);
     json j;
-    file >> j;
+    {
+        TRACE_SPAN("json::parse");
+        file >> j;
+    }
+    TRACE_SPAN("Deserialize");
     Deserialize(db, j);
 }
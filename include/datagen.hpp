@@ -0,0 +1,302 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <database.hpp>
+
+// Deterministic synthetic dataset for scale and performance testing: students, courses,
+// enrollments, grades and attendance, with foreign keys between them and Zipf-skewed
+// course popularity. The same seed and counts always produce the same rows, on every
+// platform. Used by the datagen tool and the benchmarks.
+
+/* =======================
+   RANDOMNESS
+   ======================= */
+
+// splitmix64: small, fast and identical on every platform (std distributions are not)
+class DatasetRng
+{
+public:
+    explicit DatasetRng(uint64_t seed) : state(seed) {}
+
+    uint64_t Next()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    uint64_t Below(uint64_t n) { return Next() % n; }
+    double Unit() { return static_cast<double>(Next() >> 11) * 0x1.0p-53; }
+
+    template <typename T, size_t N>
+    const T& Pick(const T (&items)[N]) { return items[Below(N)]; }
+
+private:
+    uint64_t state;
+};
+
+// Ranks 1..n with P(k) proportional to 1 / k^s, sampled by binary search over the CDF
+class ZipfSampler
+{
+public:
+    ZipfSampler(size_t n, double s) : cdf(n)
+    {
+        double sum = 0.0;
+        for (size_t k = 0; k < n; ++k)
+            cdf[k] = (sum += 1.0 / std::pow(static_cast<double>(k + 1), s));
+        for (double& c : cdf) c /= sum;
+    }
+
+    size_t Sample(DatasetRng& rng) const
+    {
+        size_t k = std::lower_bound(cdf.begin(), cdf.end(), rng.Unit()) - cdf.begin();
+        return std::min(k, cdf.size() - 1) + 1;
+    }
+
+private:
+    std::vector<double> cdf;
+};
+
+/* =======================
+   TABLES
+   ======================= */
+
+inline constexpr const char* kDatasetFirstNames[] = {
+    "Alice", "Bob", "Carol", "Dara", "Emil", "Fatima", "Gustav", "Hana", "Ivan", "Jia",
+    "Kimlang", "Leila", "Molika", "Nikhil", "Olga", "Pedro", "Quynh", "Rosa", "Sovann", "Tomas"
+};
+inline constexpr const char* kDatasetLastNames[] = {
+    "Nguyen", "Smith", "Chorn", "Garcia", "Kim", "Muller", "Rossi", "Sok", "Tanaka", "Dubois",
+    "Silva", "Novak", "Ahmed", "Larsen", "Morm", "Okafor", "Petrov", "Son", "Lopez", "Wong"
+};
+inline constexpr const char* kDatasetMajors[] = {
+    "Mathematics", "Physics", "Chemistry", "Biology", "History", "Economics",
+    "Computer Science", "Philosophy", "Literature", "Engineering", "Music", "Medicine"
+};
+inline constexpr const char* kDatasetDepartments[] = {
+    "MATH", "PHYS", "CHEM", "BIO", "HIST", "ECON", "CS", "PHIL", "LIT", "ENG", "MUS", "MED"
+};
+inline constexpr const char* kDatasetTopics[] = {
+    "Introduction to", "Advanced", "Foundations of", "Topics in", "Seminar on", "Applied"
+};
+inline constexpr const char* kDatasetStatuses[] = { "enrolled", "enrolled", "enrolled", "completed", "completed", "dropped" };
+inline constexpr const char* kDatasetAssessments[] = { "quiz", "homework", "midterm", "project", "final" };
+
+struct DatasetConfig
+{
+    uint64_t seed = 1;
+    size_t students = 10000;
+    size_t courses = 200;
+    size_t enrollments = 50000;
+    size_t grades = 100000;
+    size_t attendance = 200000;
+    double skew = 1.1;
+    size_t batch = 1000;  // rows per INSERT in SQL output
+};
+
+struct DatasetTable
+{
+    std::string name;
+    std::vector<Attribute> schema;
+    std::vector<std::string> indexes;  // besides the primary key
+    size_t rows = 0;
+    std::function<json(size_t id, DatasetRng& rng)> row;
+};
+
+inline Attribute DatasetColumn(const std::string& name, DType type, bool primary = false, bool notNull = false)
+{
+    Attribute a(name, type);
+    a.isPrimaryKey = primary;
+    a.isNotNull = notNull || primary;
+    return a;
+}
+
+// Every foreign key must point at an existing row, so a table with rows needs rows in
+// the tables it references; returns why the config is unusable, or "" when it is fine
+inline std::string DatasetConfigError(const DatasetConfig& cfg)
+{
+    if (cfg.enrollments > 0 && (cfg.students == 0 || cfg.courses == 0))
+        return "--enrollments needs --students and --courses above 0";
+    if (cfg.grades > 0 && cfg.enrollments == 0)
+        return "--grades needs --enrollments above 0";
+    if (cfg.attendance > 0 && cfg.enrollments == 0)
+        return "--attendance needs --enrollments above 0";
+    return "";
+}
+
+inline std::vector<DatasetTable> DatasetTables(const DatasetConfig& cfg)
+{
+    auto popularity = std::make_shared<ZipfSampler>(std::max<size_t>(cfg.courses, 1), cfg.skew);
+
+    // ids are 1-based; foreign keys are drawn from the referenced table's id range, which
+    // DatasetConfigError guarantees is not empty
+    auto ref = [](size_t n, DatasetRng& rng) { return static_cast<int64_t>(rng.Below(n) + 1); };
+
+    return {
+        {"students",
+         { DatasetColumn("id", DType::INT, true), DatasetColumn("name", DType::TEXT, false, true), DatasetColumn("email", DType::TEXT),
+           DatasetColumn("major", DType::TEXT), DatasetColumn("year", DType::INT), DatasetColumn("gpa", DType::REAL) },
+         {}, cfg.students,
+         [](size_t id, DatasetRng& rng) {
+             std::string first = rng.Pick(kDatasetFirstNames), last = rng.Pick(kDatasetLastNames);
+             json gpa = rng.Below(20) == 0 ? json() : json(static_cast<double>(150 + rng.Below(251)) / 100.0);
+             return json{
+                 {"id", id}, {"name", first + " " + last},
+                 {"email", first + "." + last + std::to_string(id) + "@example.edu"},
+                 {"major", rng.Pick(kDatasetMajors)}, {"year", 2015 + static_cast<int64_t>(rng.Below(10))},
+                 {"gpa", gpa}
+             };
+         }},
+        {"courses",
+         { DatasetColumn("id", DType::INT, true), DatasetColumn("code", DType::TEXT, false, true), DatasetColumn("title", DType::TEXT),
+           DatasetColumn("department", DType::TEXT), DatasetColumn("credits", DType::INT) },
+         { "department" }, cfg.courses,
+         [](size_t id, DatasetRng& rng) {
+             size_t dept = rng.Below(std::size(kDatasetDepartments));
+             return json{
+                 {"id", id}, {"code", std::string(kDatasetDepartments[dept]) + std::to_string(100 + id)},
+                 {"title", std::string(rng.Pick(kDatasetTopics)) + " " + kDatasetMajors[dept]},
+                 {"department", kDatasetDepartments[dept]}, {"credits", 1 + static_cast<int64_t>(rng.Below(6))}
+             };
+         }},
+        {"enrollments",
+         { DatasetColumn("id", DType::INT, true), DatasetColumn("student_id", DType::INT, false, true),
+           DatasetColumn("course_id", DType::INT, false, true), DatasetColumn("term", DType::INT), DatasetColumn("status", DType::TEXT) },
+         { "student_id", "course_id" }, cfg.enrollments,
+         [cfg, popularity, ref](size_t id, DatasetRng& rng) {
+             int64_t year = 2015 + static_cast<int64_t>(rng.Below(10));
+             int64_t semester = 1 + static_cast<int64_t>(rng.Below(3));
+             return json{
+                 {"id", id}, {"student_id", ref(cfg.students, rng)},
+                 {"course_id", static_cast<int64_t>(popularity->Sample(rng))},
+                 {"term", year * 10 + semester},
+                 {"status", rng.Pick(kDatasetStatuses)}
+             };
+         }},
+        {"grades",
+         { DatasetColumn("id", DType::INT, true), DatasetColumn("enrollment_id", DType::INT, false, true),
+           DatasetColumn("assessment", DType::TEXT), DatasetColumn("score", DType::REAL) },
+         { "enrollment_id" }, cfg.grades,
+         [cfg, ref](size_t id, DatasetRng& rng) {
+             // scores cluster around 70 (mean of three uniforms scaled to 40..100)
+             double score = 40.0 + (rng.Unit() + rng.Unit() + rng.Unit()) / 3.0 * 60.0;
+             return json{
+                 {"id", id}, {"enrollment_id", ref(cfg.enrollments, rng)},
+                 {"assessment", rng.Pick(kDatasetAssessments)}, {"score", std::round(score * 10.0) / 10.0}
+             };
+         }},
+        {"attendance",
+         { DatasetColumn("id", DType::INT, true), DatasetColumn("enrollment_id", DType::INT, false, true),
+           DatasetColumn("week", DType::INT), DatasetColumn("present", DType::INT) },
+         { "enrollment_id" }, cfg.attendance,
+         [cfg, ref](size_t id, DatasetRng& rng) {
+             return json{
+                 {"id", id}, {"enrollment_id", ref(cfg.enrollments, rng)},
+                 {"week", 1 + static_cast<int64_t>(rng.Below(15))}, {"present", rng.Below(10) < 9 ? 1 : 0}
+             };
+         }},
+    };
+}
+
+// Each table draws from its own stream, so its rows do not depend on other tables' sizes.
+// FNV-1a rather than std::hash, whose values differ between standard libraries.
+inline DatasetRng DatasetTableRng(uint64_t seed, const std::string& table)
+{
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (char c : table)
+        h = (h ^ static_cast<unsigned char>(c)) * 0x100000001B3ull;
+    return DatasetRng(seed ^ h);
+}
+
+/* =======================
+   WRITERS
+   ======================= */
+
+// Same layout Serialize produces (without packed columns), written row by row
+inline void WriteDatasetJson(std::ostream& out, const DatasetConfig& cfg, const std::vector<DatasetTable>& tables)
+{
+    out << "{";
+    for (size_t t = 0; t < tables.size(); ++t)
+    {
+        const auto& spec = tables[t];
+        json schema = json::array();
+        for (const auto& a : spec.schema)
+        {
+            json aj = { {"name", a.name}, {"type", static_cast<int>(a.type)} };
+            if (a.isPrimaryKey) aj["primary"] = true;
+            if (a.isNotNull) aj["not_null"] = true;
+            schema.push_back(aj);
+        }
+
+        out << (t ? ",\n" : "\n") << json(spec.name).dump() << ":{\"schema\":" << schema.dump();
+        if (!spec.indexes.empty()) out << ",\"indexes\":" << json(spec.indexes).dump();
+        out << ",\"rows\":[";
+
+        DatasetRng rng = DatasetTableRng(cfg.seed, spec.name);
+        for (size_t i = 0; i < spec.rows; ++i)
+            out << (i ? ",\n" : "\n") << spec.row(i + 1, rng).dump();
+        out << "]}";
+    }
+    out << "\n}\n";
+}
+
+inline void WriteDatasetSql(std::ostream& out, const DatasetConfig& cfg, const std::vector<DatasetTable>& tables)
+{
+    for (const auto& spec : tables)
+    {
+        out << "CREATE TABLE " << spec.name << " (";
+        for (size_t c = 0; c < spec.schema.size(); ++c)
+        {
+            const auto& a = spec.schema[c];
+            out << (c ? ", " : "") << a.name << " " << DTypeName(a.type);
+            if (a.isPrimaryKey) out << " PRIMARY KEY";
+            else if (a.isNotNull) out << " NOT NULL";
+        }
+        out << ")\n";
+        for (const auto& col : spec.indexes)
+            out << "CREATE INDEX ON " << spec.name << " (" << col << ")\n";
+    }
+
+    for (const auto& spec : tables)
+    {
+        DatasetRng rng = DatasetTableRng(cfg.seed, spec.name);
+        for (size_t i = 0; i < spec.rows; i += cfg.batch)
+        {
+            out << "INSERT " << spec.name << " [";
+            for (size_t j = i; j < std::min(spec.rows, i + cfg.batch); ++j)
+                out << (j > i ? "," : "") << spec.row(j + 1, rng).dump();
+            out << "]\n";
+        }
+    }
+}
+
+// Creates one dataset table in `db` (with its indexes) and fills it with the generated rows
+inline Table& LoadDatasetTable(Database& db, const DatasetConfig& cfg, const DatasetTable& spec)
+{
+    Table& table = db.CreateTable(spec.name);
+    for (const auto& a : spec.schema)
+        table.AddColumn(a);
+    for (const auto& a : spec.schema)
+        if (a.isPrimaryKey) CreateIndex(table, a.name);
+    for (const auto& col : spec.indexes)
+        CreateIndex(table, col);
+
+    DatasetRng rng = DatasetTableRng(cfg.seed, spec.name);
+    size_t i = 0;
+    InsertBatch(table, [&](json& out) {
+        if (i >= spec.rows) return false;
+        out = spec.row(++i, rng);
+        return true;
+    }, spec.rows);
+    return table;
+}
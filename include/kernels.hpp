@@ -0,0 +1,314 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define KERNEL_TARGET(isa)
+#else
+#define KERNEL_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+/* =======================
+   COMPARISONS
+   ======================= */
+
+enum class CompareOp
+{
+    EQ,
+    NE,
+    LT,
+    LE,
+    GT,
+    GE
+};
+
+/* =======================
+   FILTER KERNELS
+   ======================= */
+
+// Filter kernels compare a column array against one literal and write a selection
+// bitmap: bit i of out[i / 64] is set when `values[i] op literal` holds. Every kernel
+// writes (n + 63) / 64 words. The widest instruction set the CPU supports is picked
+// at runtime, so the same binary runs on machines without AVX2.
+
+enum class SimdLevel
+{
+    Scalar,
+    SSE42,
+    AVX2
+};
+
+inline const char* SimdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::Scalar: return "scalar";
+    case SimdLevel::SSE42: return "sse4.2";
+    case SimdLevel::AVX2: return "avx2";
+    }
+    return "?";
+}
+
+inline SimdLevel DetectSimdLevel()
+{
+#if defined(KERNELS_X86) && defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    bool sse42 = (info[2] >> 20) & 1;
+    bool osxsave = (info[2] >> 27) & 1;
+    bool avx = (info[2] >> 28) & 1;
+    bool avx2 = false;
+    if (osxsave && avx && (_xgetbv(0) & 6) == 6)
+    {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] >> 5) & 1;
+    }
+    if (avx2) return SimdLevel::AVX2;
+    if (sse42) return SimdLevel::SSE42;
+    return SimdLevel::Scalar;
+#elif defined(KERNELS_X86)
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse4.2")) return SimdLevel::SSE42;
+    return SimdLevel::Scalar;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+inline SimdLevel& ActiveSimdLevelRef()
+{
+    static SimdLevel level = DetectSimdLevel();
+    return level;
+}
+
+inline SimdLevel ActiveSimdLevel() { return ActiveSimdLevelRef(); }
+
+// Lowers (never raises) the level in use, e.g. to compare the paths in benchmarks
+inline void SetSimdLevel(SimdLevel level)
+{
+    SimdLevel detected = DetectSimdLevel();
+    ActiveSimdLevelRef() = level > detected ? detected : level;
+}
+
+namespace kernels
+{
+
+// LT/LE/GT/GE are evaluated as one of three base comparisons, optionally inverted:
+//   EQ: v == lit   NE: !(v == lit)   GT: v > lit   LE: !(v > lit)   LT: lit > v   GE: !(lit > v)
+enum class BaseCompare
+{
+    Equal,
+    Greater,  // value > literal
+    Less      // literal > value
+};
+
+inline BaseCompare BaseOf(CompareOp op)
+{
+    switch (op)
+    {
+    case CompareOp::EQ:
+    case CompareOp::NE: return BaseCompare::Equal;
+    case CompareOp::GT:
+    case CompareOp::LE: return BaseCompare::Greater;
+    default: return BaseCompare::Less;
+    }
+}
+
+inline bool Inverted(CompareOp op)
+{
+    return op == CompareOp::NE || op == CompareOp::LE || op == CompareOp::GE;
+}
+
+template <typename T>
+inline bool ScalarBase(T v, BaseCompare base, T lit)
+{
+    switch (base)
+    {
+    case BaseCompare::Equal: return v == lit;
+    case BaseCompare::Greater: return v > lit;
+    case BaseCompare::Less: return lit > v;
+    }
+    return false;
+}
+
+template <typename T>
+inline uint64_t ScalarWord(const T* v, size_t n, BaseCompare base, T lit)
+{
+    uint64_t word = 0;
+    for (size_t i = 0; i < n; ++i)
+        word |= uint64_t(ScalarBase(v[i], base, lit)) << i;
+    return word;
+}
+
+// Writes the base comparison for n values; the partial last word is done in scalar code
+template <typename T, typename BlockFn>
+inline void FilterWords(const T* v, size_t n, bool invert, uint64_t* out, BlockFn&& block, BaseCompare base, T lit)
+{
+    size_t full = n / 64;
+    for (size_t w = 0; w < full; ++w)
+        out[w] = block(v + w * 64);
+    if (n % 64)
+        out[full] = ScalarWord(v + full * 64, n % 64, base, lit);
+
+    if (invert)
+    {
+        size_t words = (n + 63) / 64;
+        for (size_t w = 0; w < words; ++w) out[w] = ~out[w];
+        if (n % 64) out[words - 1] &= (uint64_t(1) << (n % 64)) - 1;
+    }
+}
+
+#ifdef KERNELS_X86
+
+KERNEL_TARGET("avx2")
+inline uint64_t Int64BlockAvx2(const int64_t* v, BaseCompare base, int64_t lit)
+{
+    __m256i l = _mm256_set1_epi64x(lit);
+    uint64_t word = 0;
+    for (size_t i = 0; i < 64; i += 4)
+    {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i));
+        __m256i m = base == BaseCompare::Equal ? _mm256_cmpeq_epi64(x, l)
+            : base == BaseCompare::Greater ? _mm256_cmpgt_epi64(x, l)
+            : _mm256_cmpgt_epi64(l, x);
+        word |= uint64_t(_mm256_movemask_pd(_mm256_castsi256_pd(m))) << i;
+    }
+    return word;
+}
+
+KERNEL_TARGET("sse4.2")
+inline uint64_t Int64BlockSse42(const int64_t* v, BaseCompare base, int64_t lit)
+{
+    __m128i l = _mm_set1_epi64x(lit);
+    uint64_t word = 0;
+    for (size_t i = 0; i < 64; i += 2)
+    {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i));
+        __m128i m = base == BaseCompare::Equal ? _mm_cmpeq_epi64(x, l)
+            : base == BaseCompare::Greater ? _mm_cmpgt_epi64(x, l)
+            : _mm_cmpgt_epi64(l, x);
+        word |= uint64_t(_mm_movemask_pd(_mm_castsi128_pd(m))) << i;
+    }
+    return word;
+}
+
+KERNEL_TARGET("avx2")
+inline uint64_t DoubleBlockAvx2(const double* v, BaseCompare base, double lit)
+{
+    __m256d l = _mm256_set1_pd(lit);
+    uint64_t word = 0;
+    for (size_t i = 0; i < 64; i += 4)
+    {
+        __m256d x = _mm256_loadu_pd(v + i);
+        __m256d m = base == BaseCompare::Equal ? _mm256_cmp_pd(x, l, _CMP_EQ_OQ)
+            : base == BaseCompare::Greater ? _mm256_cmp_pd(x, l, _CMP_GT_OQ)
+            : _mm256_cmp_pd(x, l, _CMP_LT_OQ);
+        word |= uint64_t(_mm256_movemask_pd(m)) << i;
+    }
+    return word;
+}
+
+KERNEL_TARGET("sse4.2")
+inline uint64_t DoubleBlockSse42(const double* v, BaseCompare base, double lit)
+{
+    __m128d l = _mm_set1_pd(lit);
+    uint64_t word = 0;
+    for (size_t i = 0; i < 64; i += 2)
+    {
+        __m128d x = _mm_loadu_pd(v + i);
+        __m128d m = base == BaseCompare::Equal ? _mm_cmpeq_pd(x, l)
+            : base == BaseCompare::Greater ? _mm_cmpgt_pd(x, l)
+            : _mm_cmplt_pd(x, l);
+        word |= uint64_t(_mm_movemask_pd(m)) << i;
+    }
+    return word;
+}
+
+KERNEL_TARGET("avx2")
+inline uint64_t CodeBlockAvx2(const uint32_t* v, uint32_t code)
+{
+    __m256i c = _mm256_set1_epi32(static_cast<int>(code));
+    uint64_t word = 0;
+    for (size_t i = 0; i < 64; i += 8)
+    {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i));
+        __m256i m = _mm256_cmpeq_epi32(x, c);
+        word |= uint64_t(_mm256_movemask_ps(_mm256_castsi256_ps(m))) << i;
+    }
+    return word;
+}
+
+KERNEL_TARGET("sse4.2")
+inline uint64_t CodeBlockSse42(const uint32_t* v, uint32_t code)
+{
+    __m128i c = _mm_set1_epi32(static_cast<int>(code));
+    uint64_t word = 0;
+    for (size_t i = 0; i < 64; i += 4)
+    {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i));
+        __m128i m = _mm_cmpeq_epi32(x, c);
+        word |= uint64_t(_mm_movemask_ps(_mm_castsi128_ps(m))) << i;
+    }
+    return word;
+}
+
+#endif
+
+} // namespace kernels
+
+inline void FilterInt64(const int64_t* values, size_t n, CompareOp op, int64_t lit, uint64_t* out,
+                        SimdLevel level = ActiveSimdLevel())
+{
+    using namespace kernels;
+    BaseCompare base = BaseOf(op);
+    bool invert = Inverted(op);
+
+#ifdef KERNELS_X86
+    if (level == SimdLevel::AVX2)
+        return FilterWords(values, n, invert, out, [&](const int64_t* v) { return Int64BlockAvx2(v, base, lit); }, base, lit);
+    if (level == SimdLevel::SSE42)
+        return FilterWords(values, n, invert, out, [&](const int64_t* v) { return Int64BlockSse42(v, base, lit); }, base, lit);
+#endif
+    (void)level;
+    FilterWords(values, n, invert, out, [&](const int64_t* v) { return ScalarWord(v, 64, base, lit); }, base, lit);
+}
+
+inline void FilterDouble(const double* values, size_t n, CompareOp op, double lit, uint64_t* out,
+                         SimdLevel level = ActiveSimdLevel())
+{
+    using namespace kernels;
+    BaseCompare base = BaseOf(op);
+    bool invert = Inverted(op);
+
+#ifdef KERNELS_X86
+    if (level == SimdLevel::AVX2)
+        return FilterWords(values, n, invert, out, [&](const double* v) { return DoubleBlockAvx2(v, base, lit); }, base, lit);
+    if (level == SimdLevel::SSE42)
+        return FilterWords(values, n, invert, out, [&](const double* v) { return DoubleBlockSse42(v, base, lit); }, base, lit);
+#endif
+    (void)level;
+    FilterWords(values, n, invert, out, [&](const double* v) { return ScalarWord(v, 64, base, lit); }, base, lit);
+}
+
+// Dictionary codes: bit set where values[i] == code
+inline void FilterCodesEqual(const uint32_t* values, size_t n, uint32_t code, uint64_t* out,
+                             SimdLevel level = ActiveSimdLevel())
+{
+    using namespace kernels;
+    BaseCompare base = BaseCompare::Equal;
+
+#ifdef KERNELS_X86
+    if (level == SimdLevel::AVX2)
+        return FilterWords(values, n, false, out, [&](const uint32_t* v) { return CodeBlockAvx2(v, code); }, base, code);
+    if (level == SimdLevel::SSE42)
+        return FilterWords(values, n, false, out, [&](const uint32_t* v) { return CodeBlockSse42(v, code); }, base, code);
+#endif
+    (void)level;
+    FilterWords(values, n, false, out, [&](const uint32_t* v) { return ScalarWord(v, 64, base, code); }, base, code);
+}
@@ -0,0 +1,511 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+#include <alloc_tracker.hpp>
+
+/* =======================
+   LATENCY HISTOGRAMS
+   ======================= */
+
+// Log-linear histogram of nanosecond latencies in the style of HdrHistogram: values below
+// 32 get a bucket each and every larger power of two is split into 32 buckets, so a
+// percentile is reported within ~3% of the true value. Recording is a few relaxed atomic
+// operations and never locks, so any thread can record while another reads.
+class LatencyHistogram
+{
+public:
+    static constexpr unsigned kSubBits = 5;
+    static constexpr size_t kSubBuckets = size_t(1) << kSubBits;
+    static constexpr size_t kBuckets = (64 - kSubBits + 1) * kSubBuckets;
+
+    static size_t BucketOf(uint64_t v)
+    {
+        if (v < kSubBuckets) return static_cast<size_t>(v);
+        unsigned shift = static_cast<unsigned>(std::bit_width(v)) - 1 - kSubBits;
+        return (shift + 1) * kSubBuckets + static_cast<size_t>((v >> shift) - kSubBuckets);
+    }
+
+    // Largest value that falls into bucket b
+    static uint64_t BucketHigh(size_t b)
+    {
+        if (b < kSubBuckets) return b;
+        unsigned shift = static_cast<unsigned>(b / kSubBuckets) - 1;
+        uint64_t mantissa = b % kSubBuckets + kSubBuckets;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+    void Record(uint64_t ns)
+    {
+        counts[BucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t m = max.load(std::memory_order_relaxed);
+        while (ns > m && !max.compare_exchange_weak(m, ns, std::memory_order_relaxed)) {}
+    }
+
+    uint64_t Count() const { return total.load(std::memory_order_relaxed); }
+    uint64_t Sum() const { return sum.load(std::memory_order_relaxed); }
+    uint64_t Max() const { return max.load(std::memory_order_relaxed); }
+
+    // Upper bound of the bucket holding the value at quantile q (0..1)
+    uint64_t Percentile(double q) const
+    {
+        uint64_t n = Count();
+        if (n == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(std::ceil(q * static_cast<double>(n)));
+        rank = std::clamp<uint64_t>(rank, 1, n);
+
+        uint64_t seen = 0;
+        for (size_t b = 0; b < kBuckets; ++b)
+        {
+            seen += counts[b].load(std::memory_order_relaxed);
+            if (seen >= rank) return std::min(BucketHigh(b), Max());
+        }
+        return Max();
+    }
+
+    void Reset()
+    {
+        for (auto& c : counts) c.store(0, std::memory_order_relaxed);
+        total.store(0, std::memory_order_relaxed);
+        sum.store(0, std::memory_order_relaxed);
+        max.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> counts{};
+    std::atomic<uint64_t> total{ 0 };
+    std::atomic<uint64_t> sum{ 0 };
+    std::atomic<uint64_t> max{ 0 };
+};
+
+/* =======================
+   COMMAND STATISTICS
+   ======================= */
+
+enum class CommandKind
+{
+    Create,
+    Insert,
+    Select,
+    Update,
+    Remove,
+    Compact,
+    Drop,
+    Storage,
+    Memory,
+    Analyze,
+    Explain,
+    Stats,
+    SlowLog,
+    Capture,
+    Cache,
+    Other
+};
+
+constexpr size_t kCommandKinds = static_cast<size_t>(CommandKind::Other) + 1;
+
+inline const char* CommandKindName(CommandKind k)
+{
+    static constexpr const char* names[kCommandKinds] = {
+        "CREATE", "INSERT", "SELECT", "UPDATE", "REMOVE", "COMPACT",
+        "DROP", "STORAGE", "MEMORY", "ANALYZE", "EXPLAIN", "STATS", "SLOWLOG", "CAPTURE", "CACHE", "OTHER"
+    };
+    return names[static_cast<size_t>(k)];
+}
+
+// Classifies a statement by its first word, as ExecuteQuery dispatches it
+inline CommandKind CommandKindOf(const std::string& query)
+{
+    size_t start = query.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) return CommandKind::Other;
+    size_t end = query.find_first_of(" \t\r\n", start);
+    std::string word = query.substr(start, end == std::string::npos ? std::string::npos : end - start);
+
+    for (size_t k = 0; k < static_cast<size_t>(CommandKind::Other); ++k)
+        if (word == CommandKindName(static_cast<CommandKind>(k)))
+            return static_cast<CommandKind>(k);
+    return CommandKind::Other;
+}
+
+// Work done by the statement running on this thread. Plan execution adds rows scanned and
+// index hits as it runs; whoever consumes the result adds rows returned. Callers take the
+// difference around a statement, like ThreadAllocatedBytes.
+struct ExecutionCounters
+{
+    uint64_t rowsScanned = 0;
+    uint64_t rowsReturned = 0;
+    uint64_t indexHits = 0;
+    uint64_t cacheHits = 0;    // SELECTs answered from the result cache
+    uint64_t cacheMisses = 0;  // SELECTs looked up in the cache and executed
+
+    ExecutionCounters operator-(const ExecutionCounters& o) const
+    {
+        return { rowsScanned - o.rowsScanned, rowsReturned - o.rowsReturned, indexHits - o.indexHits,
+                 cacheHits - o.cacheHits, cacheMisses - o.cacheMisses };
+    }
+};
+
+inline thread_local ExecutionCounters tl_executionCounters;
+
+// Shapes of the plans the current statement ran, filled in only while the slow-query log
+// is enabled (see SlowQueryLog)
+inline thread_local std::string tl_executedPlans;
+
+struct CommandSummary
+{
+    std::string command;
+    uint64_t count = 0;
+    uint64_t errors = 0;
+    double meanMs = 0.0;
+    double p50Ms = 0.0;
+    double p99Ms = 0.0;
+    double p999Ms = 0.0;
+    double maxMs = 0.0;
+    uint64_t rowsScanned = 0;
+    uint64_t rowsReturned = 0;
+    uint64_t indexHits = 0;
+    uint64_t cacheHits = 0;
+    uint64_t cacheMisses = 0;
+
+    nlohmann::json ToJson() const
+    {
+        return {
+            {"command", command}, {"count", count}, {"errors", errors},
+            {"mean_ms", meanMs}, {"p50_ms", p50Ms}, {"p99_ms", p99Ms}, {"p999_ms", p999Ms}, {"max_ms", maxMs},
+            {"rows_scanned", rowsScanned}, {"rows_returned", rowsReturned}, {"index_hits", indexHits},
+            {"cache_hits", cacheHits}, {"cache_misses", cacheMisses}
+        };
+    }
+};
+
+// Latency histogram and work counters per command kind, for the whole process
+class QueryStats
+{
+public:
+    void Record(CommandKind kind, uint64_t nanos, bool ok, const ExecutionCounters& work)
+    {
+        auto& c = commands[static_cast<size_t>(kind)];
+        c.latency.Record(nanos);
+        if (!ok) c.errors.fetch_add(1, std::memory_order_relaxed);
+        c.rowsScanned.fetch_add(work.rowsScanned, std::memory_order_relaxed);
+        c.rowsReturned.fetch_add(work.rowsReturned, std::memory_order_relaxed);
+        c.indexHits.fetch_add(work.indexHits, std::memory_order_relaxed);
+        c.cacheHits.fetch_add(work.cacheHits, std::memory_order_relaxed);
+        c.cacheMisses.fetch_add(work.cacheMisses, std::memory_order_relaxed);
+    }
+
+    // One summary per command kind that has run since the last reset
+    std::vector<CommandSummary> Summaries() const
+    {
+        std::vector<CommandSummary> out;
+        for (size_t k = 0; k < kCommandKinds; ++k)
+        {
+            const auto& c = commands[k];
+            uint64_t n = c.latency.Count();
+            if (n == 0) continue;
+
+            auto ms = [](uint64_t ns) { return static_cast<double>(ns) / 1e6; };
+            CommandSummary s;
+            s.command = CommandKindName(static_cast<CommandKind>(k));
+            s.count = n;
+            s.errors = c.errors.load(std::memory_order_relaxed);
+            s.meanMs = ms(c.latency.Sum()) / static_cast<double>(n);
+            s.p50Ms = ms(c.latency.Percentile(0.50));
+            s.p99Ms = ms(c.latency.Percentile(0.99));
+            s.p999Ms = ms(c.latency.Percentile(0.999));
+            s.maxMs = ms(c.latency.Max());
+            s.rowsScanned = c.rowsScanned.load(std::memory_order_relaxed);
+            s.rowsReturned = c.rowsReturned.load(std::memory_order_relaxed);
+            s.indexHits = c.indexHits.load(std::memory_order_relaxed);
+            s.cacheHits = c.cacheHits.load(std::memory_order_relaxed);
+            s.cacheMisses = c.cacheMisses.load(std::memory_order_relaxed);
+            out.push_back(std::move(s));
+        }
+        return out;
+    }
+
+    void Reset()
+    {
+        for (auto& c : commands)
+        {
+            c.latency.Reset();
+            c.errors.store(0, std::memory_order_relaxed);
+            c.rowsScanned.store(0, std::memory_order_relaxed);
+            c.rowsReturned.store(0, std::memory_order_relaxed);
+            c.indexHits.store(0, std::memory_order_relaxed);
+            c.cacheHits.store(0, std::memory_order_relaxed);
+            c.cacheMisses.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    struct Command
+    {
+        LatencyHistogram latency;
+        std::atomic<uint64_t> errors{ 0 };
+        std::atomic<uint64_t> rowsScanned{ 0 };
+        std::atomic<uint64_t> rowsReturned{ 0 };
+        std::atomic<uint64_t> indexHits{ 0 };
+        std::atomic<uint64_t> cacheHits{ 0 };
+        std::atomic<uint64_t> cacheMisses{ 0 };
+    };
+
+    std::array<Command, kCommandKinds> commands;
+};
+
+inline QueryStats& GlobalQueryStats()
+{
+    static QueryStats stats;
+    return stats;
+}
+
+/* =======================
+   PERIODIC STATS DUMP
+   ======================= */
+
+// Appends a JSON line with every command summary to a file at a fixed interval, from a
+// background thread, until stopped
+class StatsDumper
+{
+public:
+    ~StatsDumper() { Stop(); }
+
+    void Start(const std::string& path, double seconds)
+    {
+        Stop();
+        if (!std::ofstream(path, std::ios::app))
+            throw std::runtime_error("Cannot open stats dump file: " + path);
+
+        stopping = false;
+        target = path;
+        interval = std::chrono::milliseconds(std::max<int64_t>(1, static_cast<int64_t>(seconds * 1000.0)));
+        worker = std::thread([this] { Loop(); });
+    }
+
+    void Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        if (worker.joinable()) worker.join();
+    }
+
+    bool Running() const { return worker.joinable(); }
+    const std::string& Path() const { return target; }
+
+private:
+    void Loop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!wake.wait_for(lock, interval, [this] { return stopping; }))
+            Dump();
+        Dump();  // final snapshot on shutdown
+    }
+
+    void Dump() const
+    {
+        nlohmann::json commands = nlohmann::json::array();
+        for (const auto& s : GlobalQueryStats().Summaries())
+            commands.push_back(s.ToJson());
+
+        auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        std::ofstream(target, std::ios::app) << nlohmann::json{ {"time_ms", now}, {"commands", commands} }.dump() << "\n";
+    }
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::string target;
+    std::chrono::milliseconds interval{ 0 };
+};
+
+inline StatsDumper& GlobalStatsDumper()
+{
+    GlobalQueryStats();  // constructed first so it outlives the dumper's last snapshot
+    static StatsDumper dumper;
+    return dumper;
+}
+
+/* =======================
+   SLOW QUERY LOG
+   ======================= */
+
+struct SlowQuery
+{
+    int64_t timeMs = 0;  // wall clock, ms since the epoch
+    std::string query;
+    std::string command;
+    bool ok = true;
+    double elapsedMs = 0.0;
+    ExecutionCounters work;
+    uint64_t bytesAllocated = 0;
+    std::string plan;
+};
+
+// Appends statements slower than a threshold to a file as JSON lines. The statement's
+// thread only checks the threshold and, for a slow statement, queues the entry; a
+// background thread formats and writes queued entries in batches, so the log never
+// blocks on I/O and costs fast statements nothing beyond one atomic load.
+class SlowQueryLog
+{
+public:
+    ~SlowQueryLog() { Stop(); }
+
+    void Start(const std::string& path, double thresholdMs)
+    {
+        Stop();
+        out.open(path, std::ios::app);
+        if (!out)
+            throw std::runtime_error("Cannot open slow query log: " + path);
+
+        stopping = false;
+        target = path;
+        threshold.store(static_cast<uint64_t>(thresholdMs * 1e6), std::memory_order_relaxed);
+        writer = std::thread([this] { Loop(); });
+        enabled.store(true, std::memory_order_release);
+    }
+
+    // Writes out everything queued so far, then closes the file
+    void Stop()
+    {
+        enabled.store(false, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        if (writer.joinable()) writer.join();
+        if (out.is_open()) out.close();
+    }
+
+    bool Enabled() const { return enabled.load(std::memory_order_acquire); }
+    uint64_t ThresholdNanos() const { return threshold.load(std::memory_order_relaxed); }
+    const std::string& Path() const { return target; }
+
+    void Submit(SlowQuery entry)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back(std::move(entry));
+        }
+        wake.notify_one();
+    }
+
+private:
+    // Buffered writes are flushed at least this often
+    static constexpr std::chrono::milliseconds kFlushInterval{ 1000 };
+
+    void Loop()
+    {
+        std::vector<SlowQuery> batch;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            wake.wait_for(lock, kFlushInterval, [this] { return stopping || !pending.empty(); });
+            batch.swap(pending);
+            bool last = stopping;
+            lock.unlock();
+
+            for (const auto& e : batch)
+                out << ToJson(e).dump() << "\n";
+            batch.clear();
+            out.flush();
+
+            lock.lock();
+            if (last && pending.empty()) return;
+        }
+    }
+
+    static nlohmann::json ToJson(const SlowQuery& e)
+    {
+        return {
+            {"time_ms", e.timeMs}, {"command", e.command}, {"ok", e.ok}, {"elapsed_ms", e.elapsedMs},
+            {"rows_scanned", e.work.rowsScanned}, {"rows_returned", e.work.rowsReturned},
+            {"index_hits", e.work.indexHits}, {"cache_hit", e.work.cacheHits > 0}, {"bytes_allocated", e.bytesAllocated},
+            {"plan", e.plan}, {"query", e.query}
+        };
+    }
+
+    std::atomic<bool> enabled{ false };
+    std::atomic<uint64_t> threshold{ 0 };
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<SlowQuery> pending;
+    bool stopping = false;
+    std::ofstream out;
+    std::string target;
+};
+
+inline SlowQueryLog& GlobalSlowQueryLog()
+{
+    static SlowQueryLog log;
+    return log;
+}
+
+/* =======================
+   COMMAND TIMING
+   ======================= */
+
+// Measures one statement from construction to Finish(): records it in the global stats
+// and, when it took longer than the threshold, in the slow-query log
+class CommandTimer
+{
+public:
+    explicit CommandTimer(const std::string& query)
+        : query(query), kind(CommandKindOf(query)), start(std::chrono::steady_clock::now()),
+          work(tl_executionCounters), bytes(ThreadAllocatedBytes())
+    {
+        tl_executedPlans.clear();
+    }
+
+    void Finish(bool ok)
+    {
+        uint64_t nanos = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        ExecutionCounters done = tl_executionCounters - work;
+        GlobalQueryStats().Record(kind, nanos, ok, done);
+
+        SlowQueryLog& log = GlobalSlowQueryLog();
+        if (!log.Enabled() || nanos < log.ThresholdNanos()) return;
+
+        SlowQuery e;
+        e.timeMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        e.query = query;
+        e.command = CommandKindName(kind);
+        e.ok = ok;
+        e.elapsedMs = static_cast<double>(nanos) / 1e6;
+        e.work = done;
+        e.bytesAllocated = ThreadAllocatedBytes() - bytes;
+        e.plan = std::move(tl_executedPlans);
+        log.Submit(std::move(e));
+    }
+
+private:
+    const std::string& query;
+    CommandKind kind;
+    std::chrono::steady_clock::time_point start;
+    ExecutionCounters work;
+    uint64_t bytes;
+};
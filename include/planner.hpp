@@ -0,0 +1,1171 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <unordered_map>
+#include <chrono>
+#include <string_view>
+#include <cstdint>
+#include <bit>
+
+#include <database.hpp>
+#include <alloc_tracker.hpp>
+#include <kernels.hpp>
+
+/* =======================
+   PREDICATES
+   ======================= */
+
+inline const char* CompareOpSymbol(CompareOp op)
+{
+    switch (op)
+    {
+    case CompareOp::EQ: return "=";
+    case CompareOp::NE: return "!=";
+    case CompareOp::LT: return "<";
+    case CompareOp::LE: return "<=";
+    case CompareOp::GT: return ">";
+    case CompareOp::GE: return ">=";
+    }
+    return "?";
+}
+
+// Mirrors `a op b` into `b op' a` (used when the literal is written first)
+inline CompareOp FlipCompareOp(CompareOp op)
+{
+    switch (op)
+    {
+    case CompareOp::LT: return CompareOp::GT;
+    case CompareOp::LE: return CompareOp::GE;
+    case CompareOp::GT: return CompareOp::LT;
+    case CompareOp::GE: return CompareOp::LE;
+    default: return op;
+    }
+}
+
+inline bool Compare(const json& lhs, CompareOp op, const json& rhs)
+{
+    if (op == CompareOp::EQ) return lhs == rhs;
+    if (op == CompareOp::NE) return lhs != rhs;
+
+    // ordering only between numbers, or between values of the same type; nulls never match
+    if (lhs.is_null() || rhs.is_null()) return false;
+    if (lhs.is_number() != rhs.is_number()) return false;
+    if (!lhs.is_number() && lhs.type() != rhs.type()) return false;
+
+    switch (op)
+    {
+    case CompareOp::LT: return lhs < rhs;
+    case CompareOp::LE: return !(rhs < lhs);
+    case CompareOp::GT: return rhs < lhs;
+    case CompareOp::GE: return !(lhs < rhs);
+    default: return false;
+    }
+}
+
+// Evaluates `stored op literal` on the typed column storage without materializing the
+// cell as json. Agrees with Compare() on the materialized value.
+template <typename T>
+inline bool CompareOrdered(T a, CompareOp op, T b)
+{
+    switch (op)
+    {
+    case CompareOp::EQ: return a == b;
+    case CompareOp::NE: return a != b;
+    case CompareOp::LT: return a < b;
+    case CompareOp::LE: return a <= b;
+    case CompareOp::GT: return a > b;
+    case CompareOp::GE: return a >= b;
+    }
+    return false;
+}
+
+inline bool IsInt64Literal(const json& lit)
+{
+    return lit.is_number_integer() && !(lit.is_number_unsigned() && lit.get<uint64_t>() > uint64_t(INT64_MAX));
+}
+
+inline bool StoredValueMatches(const TableStorage& storage, size_t row, size_t col, CompareOp op, const json& lit)
+{
+    StorageKind kind = storage.Kind(col);
+    if (kind == StorageKind::Json || storage.IsNull(row, col))
+        return Compare(storage.Get(row, col), op, lit);
+
+    switch (kind)
+    {
+    case StorageKind::Int64:
+        if (IsInt64Literal(lit))
+            return CompareOrdered(storage.GetInt(row, col), op, lit.get<int64_t>());
+        if (lit.is_number())
+            return CompareOrdered(static_cast<double>(storage.GetInt(row, col)), op, lit.get<double>());
+        break;
+    case StorageKind::Double:
+        if (lit.is_number())
+            return CompareOrdered(storage.GetDouble(row, col), op, lit.get<double>());
+        break;
+    case StorageKind::String:
+        if (lit.is_string())
+            return CompareOrdered(storage.GetString(row, col), op, std::string_view(lit.get_ref<const std::string&>()));
+        break;
+    default:
+        break;
+    }
+
+    // values of different types are never equal and never ordered
+    return op == CompareOp::NE;
+}
+
+// A column of one of the tables taking part in a query (slot = position in the FROM list)
+struct ColumnRef
+{
+    int slot = 0;
+    std::string column;
+    size_t index = 0;  // position of the column in its table's schema
+};
+
+// column op literal
+struct Predicate
+{
+    ColumnRef column;
+    CompareOp op = CompareOp::EQ;
+    json value;
+};
+
+// left.column = right.column
+struct JoinCondition
+{
+    ColumnRef left;
+    ColumnRef right;
+};
+
+/* =======================
+   LOGICAL PLAN
+   ======================= */
+
+struct LogicalQuery
+{
+    std::vector<Table*> tables;
+    std::vector<Predicate> filters;
+    std::vector<JoinCondition> joins;
+};
+
+/* =======================
+   PHYSICAL OPERATORS
+   ======================= */
+
+// Row ids, one per table slot; slots not produced by an operator are left untouched
+using Tuple = std::vector<size_t>;
+
+using TableList = std::vector<const Table*>;
+
+// Operators exchange tuples in batches of up to one row group
+constexpr size_t kTupleBatchSize = kRowGroupSize;
+
+// A batch of tuples stored slot-major: ids[slot][pos] is the row of table `slot` in the
+// tuple at position `pos`. `sel` lists the positions still in the batch, so a filter drops
+// tuples by narrowing it instead of moving row ids. Producers write the next tuple at
+// position Staged() and keep it with Commit().
+struct TupleBatch
+{
+    std::vector<std::vector<size_t>> ids;
+    std::vector<uint32_t> sel;
+
+    explicit TupleBatch(size_t slots = 0) : ids(slots, std::vector<size_t>(kTupleBatchSize))
+    {
+        sel.reserve(kTupleBatchSize);
+    }
+
+    size_t Size() const { return sel.size(); }
+    bool Full() const { return count == kTupleBatchSize; }
+
+    void Clear()
+    {
+        sel.clear();
+        count = 0;
+    }
+
+    size_t Staged() const { return count; }
+    void Commit() { sel.push_back(static_cast<uint32_t>(count++)); }
+
+    // Keeps the positions for which keep(pos) holds, in order
+    template <typename F>
+    void Narrow(F&& keep)
+    {
+        size_t n = 0;
+        for (uint32_t pos : sel)
+            if (keep(pos)) sel[n++] = pos;
+        sel.resize(n);
+    }
+
+private:
+    size_t count = 0;
+};
+
+inline json TupleValue(const TableList& tables, const TupleBatch& b, size_t pos, const ColumnRef& c)
+{
+    return tables[c.slot]->GetValue(b.ids[c.slot][pos], c.index);
+}
+
+// A predicate prepared against one table's storage. On dictionary-encoded columns,
+// = and != against a string literal compare 32-bit codes instead of strings.
+struct BoundPredicate
+{
+    const Predicate* pred = nullptr;
+    bool byCode = false;
+    bool inDictionary = false;  // literal occurs in the column (else no row can equal it)
+    uint32_t code = 0;
+};
+
+// Binds against the storage as it is now; rebind after the table is modified
+inline std::vector<BoundPredicate> BindPredicates(const Table& table, const std::vector<Predicate>& filters)
+{
+    std::vector<BoundPredicate> bound;
+    bound.reserve(filters.size());
+    for (const auto& p : filters)
+    {
+        BoundPredicate b;
+        b.pred = &p;
+        size_t col = p.column.index;
+        if (table.storage.Column(col).dictionary && p.value.is_string()
+            && (p.op == CompareOp::EQ || p.op == CompareOp::NE))
+        {
+            b.byCode = true;
+            b.inDictionary = table.storage.FindCode(col, p.value.get_ref<const std::string&>(), b.code);
+        }
+        bound.push_back(b);
+    }
+    return bound;
+}
+
+inline bool PredicateMatches(const TableStorage& st, size_t row, const BoundPredicate& b)
+{
+    const Predicate& p = *b.pred;
+    if (b.byCode)
+    {
+        bool equal = b.inDictionary && !st.IsNull(row, p.column.index)
+            && st.GetCode(row, p.column.index) == b.code;
+        return equal == (p.op == CompareOp::EQ);
+    }
+    return StoredValueMatches(st, row, p.column.index, p.op, p.value);
+}
+
+inline bool RowMatches(const Table& table, size_t row, const std::vector<BoundPredicate>& filters)
+{
+    for (const auto& b : filters)
+        if (!PredicateMatches(table.storage, row, b)) return false;
+    return true;
+}
+
+// Narrows a batch to the tuples whose row in `slot` satisfies every filter, applying one
+// filter to the whole batch at a time
+inline void FilterBatch(const Table& table, int slot, const std::vector<BoundPredicate>& filters, TupleBatch& batch)
+{
+    const auto& rows = batch.ids[slot];
+    for (const auto& b : filters)
+    {
+        if (batch.Size() == 0) return;
+        batch.Narrow([&](uint32_t pos) { return PredicateMatches(table.storage, rows[pos], b); });
+    }
+}
+
+// Whether `zone min/max op lit` can hold for some value in [min, max]
+template <typename T>
+inline bool RangeMayMatch(T min, T max, CompareOp op, T lit)
+{
+    switch (op)
+    {
+    case CompareOp::EQ: return lit >= min && lit <= max;
+    case CompareOp::NE: return !(min == lit && max == lit);
+    case CompareOp::LT: return min < lit;
+    case CompareOp::LE: return min <= lit;
+    case CompareOp::GT: return max > lit;
+    case CompareOp::GE: return max >= lit;
+    }
+    return true;
+}
+
+// False if the zone maps prove that no row of `group` satisfies every filter.
+// Only INT and FLOAT/REAL columns are summarized; other filters never rule a group out.
+inline bool GroupMayMatch(const Table& table, size_t group, const std::vector<BoundPredicate>& filters)
+{
+    const auto& st = table.storage;
+    for (const auto& b : filters)
+    {
+        const Predicate& p = *b.pred;
+        size_t col = p.column.index;
+        StorageKind kind = st.Kind(col);
+        if ((kind != StorageKind::Int64 && kind != StorageKind::Double) || p.value.is_null())
+            continue;
+
+        // nulls and values of another type only ever satisfy !=
+        const ZoneMap& zone = st.Chunk(group, col).zone;
+        if (!zone.hasValues || !p.value.is_number())
+        {
+            if (p.op != CompareOp::NE) return false;
+            continue;
+        }
+        if (p.op == CompareOp::NE && zone.nullCount > 0)
+            continue;
+
+        bool may = true;
+        const json& lit = p.value;
+        if (kind == StorageKind::Int64)
+        {
+            if (IsInt64Literal(lit))
+                may = RangeMayMatch(zone.minInt, zone.maxInt, p.op, lit.get<int64_t>());
+            else
+                may = RangeMayMatch(static_cast<double>(zone.minInt), static_cast<double>(zone.maxInt), p.op, lit.get<double>());
+        }
+        else
+            may = RangeMayMatch(zone.minDouble, zone.maxDouble, p.op, lit.get<double>());
+        if (!may) return false;
+    }
+    return true;
+}
+
+// Fills `sel` (kNullWords words) with the rows of `group` that are live and satisfy every
+// filter, and returns the number of live rows examined. INT and FLOAT/REAL comparisons
+// with a numeric literal and dictionary code equality run through the filter kernels over
+// the whole group; any other filter is checked row by row on the rows still selected.
+inline size_t SelectGroup(const Table& table, size_t group, const std::vector<BoundPredicate>& filters, uint64_t* sel)
+{
+    const auto& st = table.storage;
+    size_t first = group * kRowGroupSize;
+    size_t n = std::min(kRowGroupSize, st.RowCount() - first);
+
+    size_t live = 0;
+    for (size_t w = 0; w < kNullWords; ++w)
+    {
+        size_t begin = w * 64;
+        uint64_t inRange = begin >= n ? 0 : (n - begin >= 64 ? ~uint64_t(0) : (uint64_t(1) << (n - begin)) - 1);
+        sel[w] = ~table.DeletedWord(first / 64 + w) & inRange;
+        live += std::popcount(sel[w]);
+    }
+
+    uint64_t match[kNullWords];
+    int64_t decoded[kRowGroupSize];
+    std::vector<const BoundPredicate*> residual;
+
+    for (const auto& b : filters)
+    {
+        const Predicate& p = *b.pred;
+        size_t col = p.column.index;
+        const ColumnChunk& chunk = st.Chunk(group, col);
+        StorageKind kind = st.Kind(col);
+
+        if (b.byCode)
+        {
+            if (b.inDictionary)
+                FilterCodesEqual(static_cast<const uint32_t*>(chunk.values), kRowGroupSize, b.code, match);
+            else
+                std::fill(match, match + kNullWords, uint64_t(0));
+            if (p.op == CompareOp::NE)
+                for (auto& m : match) m = ~m;
+        }
+        else if (kind == StorageKind::Int64 && IsInt64Literal(p.value))
+            FilterInt64(st.IntGroup(group, col, decoded), kRowGroupSize, p.op, p.value.get<int64_t>(), match);
+        else if (kind == StorageKind::Double && p.value.is_number())
+            FilterDouble(static_cast<const double*>(chunk.values), kRowGroupSize, p.op, p.value.get<double>(), match);
+        else
+        {
+            residual.push_back(&b);
+            continue;
+        }
+
+        // a null cell satisfies != against a literal and nothing else
+        bool any = false;
+        for (size_t w = 0; w < kNullWords; ++w)
+        {
+            sel[w] &= p.op == CompareOp::NE ? (match[w] | chunk.nulls[w]) : (match[w] & ~chunk.nulls[w]);
+            any |= sel[w] != 0;
+        }
+        if (!any) return live;
+    }
+
+    if (residual.empty()) return live;
+
+    for (size_t w = 0; w < kNullWords; ++w)
+    {
+        uint64_t bits = sel[w];
+        while (bits)
+        {
+            size_t bit = std::countr_zero(bits);
+            bits &= bits - 1;
+            size_t row = first + w * 64 + bit;
+            for (const BoundPredicate* b : residual)
+            {
+                if (!StoredValueMatches(st, row, b->pred->column.index, b->pred->op, b->pred->value))
+                {
+                    sel[w] &= ~(uint64_t(1) << bit);
+                    break;
+                }
+            }
+        }
+    }
+    return live;
+}
+
+inline bool JoinMatches(const TableList& tables, const TupleBatch& b, size_t pos, const std::vector<JoinCondition>& conds)
+{
+    for (const auto& c : conds)
+    {
+        json l = TupleValue(tables, b, pos, c.left);
+        if (l.is_null() || l != TupleValue(tables, b, pos, c.right))
+            return false;
+    }
+    return true;
+}
+
+inline std::string DescribeColumn(const TableList& tables, const ColumnRef& c)
+{
+    return tables.size() > 1 ? tables[c.slot]->name + "." + c.column : c.column;
+}
+
+inline std::string DescribeFilters(const TableList& tables, const std::vector<Predicate>& filters)
+{
+    std::string s;
+    for (const auto& p : filters)
+    {
+        if (!s.empty()) s += " AND ";
+        s += DescribeColumn(tables, p.column) + " " + CompareOpSymbol(p.op) + " " + p.value.dump();
+    }
+    return s;
+}
+
+inline std::string DescribeJoin(const TableList& tables, const ColumnRef& l, const ColumnRef& r)
+{
+    return DescribeColumn(tables, l) + " = " + DescribeColumn(tables, r);
+}
+
+// Actual work done by one operator, collected for EXPLAIN ANALYZE.
+// Time and bytes include the operator's children.
+struct OperatorMetrics
+{
+    uint64_t rowsIn = 0;         // rows examined (scans) or received from children (joins)
+    uint64_t rowsOut = 0;
+    uint64_t indexHits = 0;      // row ids obtained from an index
+    uint64_t groupsSkipped = 0;  // row groups ruled out by zone maps (scans)
+    uint64_t nanos = 0;
+    uint64_t bytesAllocated = 0;
+};
+
+// Pull-based operator: Open() once, then NextBatch() until it returns false. Every call
+// that returns true leaves at least one tuple in the batch.
+class PhysicalOperator
+{
+public:
+    virtual ~PhysicalOperator() = default;
+
+    void Open()
+    {
+        if (!instrument)
+        {
+            DoOpen();
+            return;
+        }
+        Measure([&] { DoOpen(); return true; });
+    }
+
+    bool NextBatch(TupleBatch& out)
+    {
+        if (!instrument)
+            return DoNextBatch(out);
+        bool more = Measure([&] { return DoNextBatch(out); });
+        if (more) metrics.rowsOut += out.Size();
+        return more;
+    }
+
+    virtual std::string Name() const = 0;
+    virtual std::string Detail() const { return ""; }
+
+    double estimatedRows = 0.0;
+    double estimatedCost = 0.0;
+    std::vector<int> slots;  // table slots filled in by this subtree
+    std::vector<std::unique_ptr<PhysicalOperator>> children;
+
+    bool instrument = false;
+    OperatorMetrics metrics;
+
+protected:
+    virtual void DoOpen() = 0;
+    virtual bool DoNextBatch(TupleBatch& out) = 0;
+
+private:
+    template <typename F>
+    bool Measure(F&& f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t bytes = ThreadAllocatedBytes();
+        bool r = f();
+        metrics.bytesAllocated += ThreadAllocatedBytes() - bytes;
+        metrics.nanos += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        return r;
+    }
+};
+
+inline void EnableInstrumentation(PhysicalOperator& op)
+{
+    op.instrument = true;
+    for (auto& c : op.children)
+        EnableInstrumentation(*c);
+}
+
+using OperatorPtr = std::unique_ptr<PhysicalOperator>;
+
+// Emits the matches of one row group per batch
+class SeqScanOp : public PhysicalOperator
+{
+public:
+    SeqScanOp(const Table& t, int slot, std::vector<Predicate> f)
+        : table(t), slot(slot), filters(std::move(f))
+    {
+        slots = { slot };
+    }
+
+    void DoOpen() override
+    {
+        bound = BindPredicates(table, filters);
+        nextGroup = 0;
+    }
+
+    bool DoNextBatch(TupleBatch& out) override
+    {
+        out.Clear();
+        auto& rows = out.ids[slot];
+        uint64_t sel[kNullWords];
+
+        while (nextGroup < table.storage.GroupCount())
+        {
+            size_t group = nextGroup++;
+            if (!bound.empty() && !GroupMayMatch(table, group, bound))
+            {
+                ++metrics.groupsSkipped;
+                continue;
+            }
+
+            metrics.rowsIn += SelectGroup(table, group, bound, sel);
+            for (size_t w = 0; w < kNullWords; ++w)
+            {
+                for (uint64_t bits = sel[w]; bits; bits &= bits - 1)
+                {
+                    rows[out.Staged()] = group * kRowGroupSize + w * 64 + std::countr_zero(bits);
+                    out.Commit();
+                }
+            }
+            if (out.Size()) return true;
+        }
+        return false;
+    }
+
+    std::string Name() const override { return "SeqScan " + table.name; }
+    std::string Detail() const override { return filters.empty() ? "" : "filter: " + DescribeFilters({ &table }, filters); }
+
+    const Table& table;
+    int slot;
+    std::vector<Predicate> filters;
+
+private:
+    std::vector<BoundPredicate> bound;
+    size_t nextGroup = 0;
+};
+
+class IndexLookupOp : public PhysicalOperator
+{
+public:
+    IndexLookupOp(const Table& t, int slot, const Index& idx, json k, std::vector<Predicate> residual)
+        : table(t), slot(slot), index(idx), key(std::move(k)), filters(std::move(residual))
+    {
+        slots = { slot };
+    }
+
+    void DoOpen() override
+    {
+        hits = index.Find(key);
+        bound = BindPredicates(table, filters);
+        pos = 0;
+    }
+
+    bool DoNextBatch(TupleBatch& out) override
+    {
+        auto& rows = out.ids[slot];
+        while (hits && pos < hits->size())
+        {
+            out.Clear();
+            while (pos < hits->size() && !out.Full())
+            {
+                size_t i = (*hits)[pos++];
+                if (table.IsDeleted(i)) continue;
+                ++metrics.rowsIn;
+                ++metrics.indexHits;
+                rows[out.Staged()] = i;
+                out.Commit();
+            }
+            FilterBatch(table, slot, bound, out);
+            if (out.Size()) return true;
+        }
+        return false;
+    }
+
+    std::string Name() const override { return "IndexLookup " + table.name + "." + index.column; }
+
+    std::string Detail() const override
+    {
+        std::string d = "key: " + key.dump();
+        if (!filters.empty()) d += ", filter: " + DescribeFilters({ &table }, filters);
+        return d;
+    }
+
+    const Table& table;
+    int slot;
+    const Index& index;
+    json key;
+    std::vector<Predicate> filters;
+
+private:
+    std::vector<BoundPredicate> bound;
+    const std::vector<size_t>* hits = nullptr;
+    size_t pos = 0;
+};
+
+// Walks the tuples of child batches one position at a time, pulling the next batch when
+// the current one is used up
+class BatchReader
+{
+public:
+    BatchReader(PhysicalOperator& op, size_t slots) : op(op), batch(slots) {}
+
+    // Moves to the next tuple; false once the operator is exhausted
+    bool Advance()
+    {
+        while (++i >= batch.Size())
+        {
+            if (done || !op.NextBatch(batch))
+            {
+                done = true;
+                return false;
+            }
+            i = static_cast<size_t>(-1);
+        }
+        return true;
+    }
+
+    size_t Pos() const { return batch.sel[i]; }
+    const TupleBatch& Batch() const { return batch; }
+
+private:
+    PhysicalOperator& op;
+    TupleBatch batch;
+    size_t i = static_cast<size_t>(-1);
+    bool done = false;
+};
+
+// Builds a hash table over children[0] and streams children[1] through it
+class HashJoinOp : public PhysicalOperator
+{
+public:
+    HashJoinOp(const TableList& t, OperatorPtr build, OperatorPtr probe,
+               ColumnRef buildKey, ColumnRef probeKey, std::vector<JoinCondition> residual)
+        : tables(t), buildKey(std::move(buildKey)), probeKey(std::move(probeKey)), residual(std::move(residual))
+    {
+        slots = build->slots;
+        slots.insert(slots.end(), probe->slots.begin(), probe->slots.end());
+        children.push_back(std::move(build));
+        children.push_back(std::move(probe));
+    }
+
+    void DoOpen() override
+    {
+        hashTable.clear();
+        TupleBatch b(tables.size());
+        Tuple t(tables.size());
+        children[0]->Open();
+        while (children[0]->NextBatch(b))
+        {
+            metrics.rowsIn += b.Size();
+            for (uint32_t pos : b.sel)
+            {
+                json k = TupleValue(tables, b, pos, buildKey);
+                if (k.is_null()) continue;
+                for (int s : children[0]->slots) t[s] = b.ids[s][pos];
+                hashTable[std::move(k)].push_back(t);
+            }
+        }
+        children[1]->Open();
+        probe = std::make_unique<BatchReader>(*children[1], tables.size());
+        matches = nullptr;
+        pos = 0;
+    }
+
+    bool DoNextBatch(TupleBatch& out) override
+    {
+        out.Clear();
+        while (!out.Full())
+        {
+            if (matches && pos < matches->size())
+            {
+                const Tuple& b = (*matches)[pos++];
+                size_t o = out.Staged();
+                for (int s : children[0]->slots) out.ids[s][o] = b[s];
+                for (int s : children[1]->slots) out.ids[s][o] = probe->Batch().ids[s][probe->Pos()];
+                if (JoinMatches(tables, out, o, residual)) out.Commit();
+                continue;
+            }
+
+            if (!probe->Advance()) break;
+            ++metrics.rowsIn;
+            auto it = hashTable.find(TupleValue(tables, probe->Batch(), probe->Pos(), probeKey));
+            matches = it == hashTable.end() ? nullptr : &it->second;
+            pos = 0;
+        }
+        return out.Size() > 0;
+    }
+
+    std::string Name() const override { return "HashJoin"; }
+    std::string Detail() const override { return "build: " + DescribeJoin(tables, buildKey, probeKey); }
+
+    const TableList& tables;
+    ColumnRef buildKey;
+    ColumnRef probeKey;
+    std::vector<JoinCondition> residual;
+
+private:
+    std::unordered_map<json, std::vector<Tuple>, JsonKeyHash> hashTable;
+    std::unique_ptr<BatchReader> probe;
+    const std::vector<Tuple>* matches = nullptr;
+    size_t pos = 0;
+};
+
+// For every outer tuple, probes the inner table's hash index on the join column
+class IndexNestedLoopJoinOp : public PhysicalOperator
+{
+public:
+    IndexNestedLoopJoinOp(const TableList& t, OperatorPtr outer, int innerSlot, const Index& idx,
+                          ColumnRef outerKey, std::vector<Predicate> innerFilters,
+                          std::vector<JoinCondition> residual)
+        : tables(t), innerSlot(innerSlot), index(idx), outerKey(std::move(outerKey)),
+          innerFilters(std::move(innerFilters)), residual(std::move(residual))
+    {
+        slots = outer->slots;
+        slots.push_back(innerSlot);
+        children.push_back(std::move(outer));
+    }
+
+    void DoOpen() override
+    {
+        children[0]->Open();
+        outer = std::make_unique<BatchReader>(*children[0], tables.size());
+        innerBound = BindPredicates(*tables[innerSlot], innerFilters);
+        hits = nullptr;
+        pos = 0;
+    }
+
+    bool DoNextBatch(TupleBatch& out) override
+    {
+        const Table& inner = *tables[innerSlot];
+        out.Clear();
+        while (!out.Full())
+        {
+            if (hits && pos < hits->size())
+            {
+                size_t i = (*hits)[pos++];
+                if (inner.IsDeleted(i)) continue;
+                ++metrics.indexHits;
+                if (!RowMatches(inner, i, innerBound)) continue;
+
+                size_t o = out.Staged();
+                for (int s : children[0]->slots) out.ids[s][o] = outer->Batch().ids[s][outer->Pos()];
+                out.ids[innerSlot][o] = i;
+                if (JoinMatches(tables, out, o, residual)) out.Commit();
+                continue;
+            }
+
+            if (!outer->Advance()) break;
+            ++metrics.rowsIn;
+            json k = TupleValue(tables, outer->Batch(), outer->Pos(), outerKey);
+            hits = k.is_null() ? nullptr : index.Find(k);
+            pos = 0;
+        }
+        return out.Size() > 0;
+    }
+
+    std::string Name() const override
+    {
+        return "IndexNestedLoopJoin " + tables[innerSlot]->name + "." + index.column;
+    }
+
+    std::string Detail() const override
+    {
+        std::string d = "key: " + DescribeColumn(tables, outerKey);
+        if (!innerFilters.empty()) d += ", filter: " + DescribeFilters(tables, innerFilters);
+        return d;
+    }
+
+    const TableList& tables;
+    int innerSlot;
+    const Index& index;
+    ColumnRef outerKey;
+    std::vector<Predicate> innerFilters;
+    std::vector<JoinCondition> residual;
+
+private:
+    std::unique_ptr<BatchReader> outer;
+    std::vector<BoundPredicate> innerBound;
+    const std::vector<size_t>* hits = nullptr;
+    size_t pos = 0;
+};
+
+// Materializes children[1] once and compares it against every outer tuple
+class NestedLoopJoinOp : public PhysicalOperator
+{
+public:
+    NestedLoopJoinOp(const TableList& t, OperatorPtr outer, OperatorPtr inner, std::vector<JoinCondition> conds)
+        : tables(t), conditions(std::move(conds))
+    {
+        slots = outer->slots;
+        slots.insert(slots.end(), inner->slots.begin(), inner->slots.end());
+        children.push_back(std::move(outer));
+        children.push_back(std::move(inner));
+    }
+
+    void DoOpen() override
+    {
+        innerRows.clear();
+        TupleBatch b(tables.size());
+        Tuple t(tables.size());
+        children[1]->Open();
+        while (children[1]->NextBatch(b))
+        {
+            metrics.rowsIn += b.Size();
+            for (uint32_t p : b.sel)
+            {
+                for (int s : children[1]->slots) t[s] = b.ids[s][p];
+                innerRows.push_back(t);
+            }
+        }
+        children[0]->Open();
+        outer = std::make_unique<BatchReader>(*children[0], tables.size());
+        pos = innerRows.size();
+    }
+
+    bool DoNextBatch(TupleBatch& out) override
+    {
+        out.Clear();
+        while (!out.Full())
+        {
+            if (pos < innerRows.size())
+            {
+                const Tuple& in = innerRows[pos++];
+                size_t o = out.Staged();
+                for (int s : children[0]->slots) out.ids[s][o] = outer->Batch().ids[s][outer->Pos()];
+                for (int s : children[1]->slots) out.ids[s][o] = in[s];
+                if (JoinMatches(tables, out, o, conditions)) out.Commit();
+                continue;
+            }
+
+            if (!outer->Advance()) break;
+            ++metrics.rowsIn;
+            pos = 0;
+        }
+        return out.Size() > 0;
+    }
+
+    std::string Name() const override { return "NestedLoopJoin"; }
+    std::string Detail() const override { return DescribeJoin(tables, conditions.front().left, conditions.front().right); }
+
+    const TableList& tables;
+    std::vector<JoinCondition> conditions;
+
+private:
+    std::unique_ptr<BatchReader> outer;
+    std::vector<Tuple> innerRows;
+    size_t pos = 0;
+};
+
+struct PhysicalPlan
+{
+    // tables are owned by the plan so operators can keep references to the list
+    std::unique_ptr<TableList> tables;
+    OperatorPtr root;
+};
+
+/* =======================
+   COST MODEL
+   ======================= */
+
+constexpr double kSeqRowCost = 1.0;        // reading one row sequentially
+constexpr double kZoneCheckCost = 1.0;     // checking one row group's zone maps
+constexpr double kPredicateCost = 0.25;    // evaluating one predicate on one row
+constexpr double kIndexProbeCost = 4.0;    // one hash index lookup
+constexpr double kIndexRowCost = 1.5;      // fetching one row through an index
+constexpr double kHashBuildRowCost = 2.0;  // inserting one tuple into a join hash table
+constexpr double kHashProbeRowCost = 1.0;  // probing the join hash table once
+
+// Fallback selectivities when neither statistics nor an index can tell us more
+constexpr double kDefaultEqSelectivity = 0.005;
+constexpr double kDefaultRangeSelectivity = 1.0 / 3.0;
+
+inline double EstimateSelectivity(const Table& table, const Predicate& p)
+{
+    double rows = static_cast<double>(table.LiveRowCount());
+    if (rows == 0) return 0.0;
+
+    // an index knows the exact number of rows for a key
+    if (p.op == CompareOp::EQ || p.op == CompareOp::NE)
+    {
+        if (const Index* idx = table.FindIndex(p.column.column))
+        {
+            const auto* hits = idx->Find(p.value);
+            double eq = hits ? static_cast<double>(hits->size()) / rows : 0.0;
+            return p.op == CompareOp::EQ ? eq : 1.0 - eq;
+        }
+    }
+
+    auto it = table.stats.columns.find(p.column.column);
+    if (!table.stats.analyzed || it == table.stats.columns.end())
+    {
+        if (p.op == CompareOp::EQ) return kDefaultEqSelectivity;
+        if (p.op == CompareOp::NE) return 1.0 - kDefaultEqSelectivity;
+        return kDefaultRangeSelectivity;
+    }
+
+    const ColumnStats& cs = it->second;
+    double nonNull = 1.0 - cs.nullFraction;
+    switch (p.op)
+    {
+    case CompareOp::EQ: return EstimateEqualsSelectivity(cs, p.value);
+    case CompareOp::NE: return std::max(0.0, nonNull - EstimateEqualsSelectivity(cs, p.value));
+    case CompareOp::LT: return EstimateLessThanSelectivity(cs, p.value, false);
+    case CompareOp::LE: return EstimateLessThanSelectivity(cs, p.value, true);
+    case CompareOp::GT: return std::max(0.0, nonNull - EstimateLessThanSelectivity(cs, p.value, true));
+    case CompareOp::GE: return std::max(0.0, nonNull - EstimateLessThanSelectivity(cs, p.value, false));
+    }
+    return 1.0;
+}
+
+inline double EstimateDistinct(const Table& table, const std::string& column)
+{
+    if (const Index* idx = table.FindIndex(column))
+        return std::max<double>(1.0, static_cast<double>(idx->entries.size()));
+
+    auto it = table.stats.columns.find(column);
+    if (table.stats.analyzed && it != table.stats.columns.end() && it->second.distinct >= 1.0)
+        return it->second.distinct;
+
+    // unknown: assume the column is close to a key
+    return std::max<double>(1.0, static_cast<double>(table.LiveRowCount()));
+}
+
+/* =======================
+   PLANNER
+   ======================= */
+
+// Cheapest way to read one table with its local filters: full scan or a single index lookup
+inline OperatorPtr PlanAccessPath(const Table& table, int slot, const std::vector<Predicate>& filters)
+{
+    double rows = static_cast<double>(table.LiveRowCount());
+
+    double selectivity = 1.0;
+    for (const auto& p : filters)
+        selectivity *= EstimateSelectivity(table, p);
+    double outRows = rows * selectivity;
+
+    // a scan only reads the row groups its filters' zone maps cannot rule out
+    double scanFraction = 1.0;
+    size_t groups = table.storage.GroupCount();
+    if (!filters.empty() && groups > 0)
+    {
+        auto bound = BindPredicates(table, filters);
+        size_t kept = 0;
+        for (size_t g = 0; g < groups; ++g)
+            if (GroupMayMatch(table, g, bound)) ++kept;
+        scanFraction = static_cast<double>(kept) / static_cast<double>(groups);
+    }
+
+    OperatorPtr best = std::make_unique<SeqScanOp>(table, slot, filters);
+    best->estimatedRows = outRows;
+    best->estimatedCost = rows * scanFraction * (kSeqRowCost + kPredicateCost * static_cast<double>(filters.size()))
+        + (filters.empty() ? 0.0 : static_cast<double>(groups) * kZoneCheckCost);
+
+    for (size_t i = 0; i < filters.size(); ++i)
+    {
+        const auto& p = filters[i];
+        if (p.op != CompareOp::EQ) continue;
+        const Index* idx = table.FindIndex(p.column.column);
+        if (!idx) continue;
+
+        std::vector<Predicate> residual;
+        for (size_t j = 0; j < filters.size(); ++j)
+            if (j != i) residual.push_back(filters[j]);
+
+        double matched = rows * EstimateSelectivity(table, p);
+        double cost = kIndexProbeCost
+            + matched * (kIndexRowCost + kPredicateCost * static_cast<double>(residual.size()));
+
+        if (cost < best->estimatedCost)
+        {
+            best = std::make_unique<IndexLookupOp>(table, slot, *idx, p.value, std::move(residual));
+            best->estimatedRows = outRows;
+            best->estimatedCost = cost;
+        }
+    }
+
+    return best;
+}
+
+// Rows of one table whose column equals a value, through the same access paths as SELECT
+inline std::vector<Entity> Select(
+    const Table& table,
+    const std::string& column,
+    const json& value)
+{
+    Predicate p;
+    p.column.column = column;
+    p.column.index = table.ColumnIndex(column);
+    p.value = value;
+
+    std::vector<Entity> result;
+    OperatorPtr op = PlanAccessPath(table, 0, { p });
+    TupleBatch batch(1);
+    op->Open();
+    while (op->NextBatch(batch))
+        for (uint32_t pos : batch.sel)
+            result.push_back(table.GetRow(batch.ids[0][pos]));
+    return result;
+}
+
+inline bool ContainsSlot(const std::vector<int>& slots, int slot)
+{
+    return std::find(slots.begin(), slots.end(), slot) != slots.end();
+}
+
+// Greedy join ordering: start from the relation with the fewest estimated rows, then
+// repeatedly add the connected relation whose join step is cheapest, choosing between
+// hash join, index nested-loop join and plain nested-loop join for each step.
+inline PhysicalPlan PlanQuery(const LogicalQuery& q)
+{
+    PhysicalPlan plan;
+    plan.tables = std::make_unique<TableList>(q.tables.begin(), q.tables.end());
+    const TableList& tables = *plan.tables;
+    const int n = static_cast<int>(tables.size());
+
+    std::vector<std::vector<Predicate>> localFilters(n);
+    for (const auto& p : q.filters)
+        localFilters[p.column.slot].push_back(p);
+
+    std::vector<OperatorPtr> access(n);
+    for (int s = 0; s < n; ++s)
+        access[s] = PlanAccessPath(*tables[s], s, localFilters[s]);
+
+    int start = 0;
+    for (int s = 1; s < n; ++s)
+        if (access[s]->estimatedRows < access[start]->estimatedRows) start = s;
+
+    OperatorPtr current = std::move(access[start]);
+    std::vector<bool> joined(n, false);
+    joined[start] = true;
+
+    enum class JoinMethod { Hash, IndexNestedLoop, NestedLoop };
+
+    for (int step = 1; step < n; ++step)
+    {
+        int bestSlot = -1;
+        JoinMethod bestMethod = JoinMethod::Hash;
+        double bestCost = std::numeric_limits<double>::infinity();
+        double bestRows = 0.0;
+        std::vector<JoinCondition> bestConds;
+
+        for (int r = 0; r < n; ++r)
+        {
+            if (joined[r]) continue;
+
+            // join conditions linking r to what has been joined so far, oriented (current, r)
+            std::vector<JoinCondition> conds;
+            for (const auto& jc : q.joins)
+            {
+                if (jc.right.slot == r && ContainsSlot(current->slots, jc.left.slot))
+                    conds.push_back(jc);
+                else if (jc.left.slot == r && ContainsSlot(current->slots, jc.right.slot))
+                    conds.push_back({ jc.right, jc.left });
+            }
+            if (conds.empty()) continue;
+
+            const Table& inner = *tables[r];
+            const JoinCondition& key = conds.front();
+
+            double leftRows = current->estimatedRows;
+            double rightRows = access[r]->estimatedRows;
+            double ndv = std::max(EstimateDistinct(*tables[key.left.slot], key.left.column),
+                                  EstimateDistinct(inner, key.right.column));
+
+            // hash join, building on the smaller input
+            double hashCost = current->estimatedCost + access[r]->estimatedCost
+                + std::min(leftRows, rightRows) * kHashBuildRowCost
+                + std::max(leftRows, rightRows) * kHashProbeRowCost;
+
+            // index nested-loop join into r's index on the join column
+            double inlCost = std::numeric_limits<double>::infinity();
+            if (inner.FindIndex(key.right.column))
+            {
+                double perKey = static_cast<double>(inner.LiveRowCount()) / EstimateDistinct(inner, key.right.column);
+                inlCost = current->estimatedCost + leftRows * (kIndexProbeCost
+                    + perKey * (kIndexRowCost + kPredicateCost * static_cast<double>(localFilters[r].size())));
+            }
+
+            // nested-loop join over the materialized inner side
+            double nljCost = current->estimatedCost + access[r]->estimatedCost
+                + leftRows * rightRows * kPredicateCost * static_cast<double>(conds.size());
+
+            JoinMethod method = JoinMethod::Hash;
+            double cost = hashCost;
+            if (inlCost < cost) { method = JoinMethod::IndexNestedLoop; cost = inlCost; }
+            if (nljCost < cost) { method = JoinMethod::NestedLoop; cost = nljCost; }
+
+            if (cost < bestCost)
+            {
+                bestSlot = r;
+                bestMethod = method;
+                bestCost = cost;
+                bestRows = leftRows * rightRows / ndv;
+                bestConds = std::move(conds);
+            }
+        }
+
+        if (bestSlot < 0)
+            throw std::runtime_error("Query joins tables without a join condition");
+
+        const int r = bestSlot;
+        const JoinCondition key = bestConds.front();
+        std::vector<JoinCondition> residual(bestConds.begin() + 1, bestConds.end());
+        OperatorPtr next;
+
+        if (bestMethod == JoinMethod::IndexNestedLoop)
+        {
+            next = std::make_unique<IndexNestedLoopJoinOp>(tables, std::move(current), r,
+                *tables[r]->FindIndex(key.right.column), key.left, localFilters[r], std::move(residual));
+        }
+        else if (bestMethod == JoinMethod::Hash)
+        {
+            if (access[r]->estimatedRows <= current->estimatedRows)
+                next = std::make_unique<HashJoinOp>(tables, std::move(access[r]), std::move(current),
+                    key.right, key.left, std::move(residual));
+            else
+                next = std::make_unique<HashJoinOp>(tables, std::move(current), std::move(access[r]),
+                    key.left, key.right, std::move(residual));
+        }
+        else
+        {
+            next = std::make_unique<NestedLoopJoinOp>(tables, std::move(current), std::move(access[r]), bestConds);
+        }
+
+        next->estimatedRows = bestRows;
+        next->estimatedCost = bestCost;
+        current = std::move(next);
+        joined[r] = true;
+    }
+
+    plan.root = std::move(current);
+    return plan;
+}
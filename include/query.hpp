@@ -0,0 +1,1638 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <unordered_set>
+
+#include <database.hpp>
+#include <planner.hpp>
+#include <metrics.hpp>
+#include <workload.hpp>
+#include <result_cache.hpp>
+
+/* =======================
+   QUERY SYSTEM
+   ======================= */
+
+constexpr size_t kResultBatchSize = 1024;
+
+// Pull-based stream of result rows. Consumers call NextBatch until it returns false;
+// rows are produced on demand, so the first batch is available after at most
+// kResultBatchSize matches regardless of table size. A cursor reading a table is only
+// valid until the next statement modifies that table.
+class RowCursor
+{
+public:
+    virtual ~RowCursor() = default;
+
+    // Replaces `batch` with up to kResultBatchSize rows; false (and empty) when done
+    virtual bool NextBatch(std::vector<Entity>& batch) = 0;
+
+    // The rest of the result when it already exists as a shared, immutable vector (a
+    // cache hit), for consumers that only read rows; consumes it like NextBatch would.
+    // Null when rows are produced as they are pulled.
+    virtual const std::vector<Entity>* TakeSharedRows() { return nullptr; }
+};
+
+// Cursor over rows that were already materialized (ANALYZE output, removed rows, ...)
+class VectorCursor : public RowCursor
+{
+public:
+    explicit VectorCursor(std::vector<Entity> r) : rows(std::move(r)) {}
+
+    bool NextBatch(std::vector<Entity>& batch) override
+    {
+        batch.clear();
+        size_t end = std::min(rows.size(), pos + kResultBatchSize);
+        for (; pos < end; ++pos)
+            batch.push_back(std::move(rows[pos]));
+        return !batch.empty();
+    }
+
+private:
+    std::vector<Entity> rows;
+    size_t pos = 0;
+};
+
+struct QueryResult
+{
+    bool hasResult = false;
+    std::shared_ptr<RowCursor> cursor;
+
+    // Set by statements that modify rows instead of returning them
+    std::optional<size_t> affectedRows;
+
+    // Column order for display; empty means the order of the first row's fields
+    std::vector<std::string> columns;
+
+    static QueryResult Affected(size_t n)
+    {
+        QueryResult r;
+        r.hasResult = true;
+        r.affectedRows = n;
+        return r;
+    }
+
+    static QueryResult FromRows(std::vector<Entity> rows, std::vector<std::string> columns = {})
+    {
+        QueryResult r;
+        r.hasResult = true;
+        r.columns = std::move(columns);
+        r.cursor = std::make_shared<VectorCursor>(std::move(rows));
+        return r;
+    }
+
+    // Pulls every remaining row; for callers that need the whole result at once
+    std::vector<Entity> Drain()
+    {
+        std::vector<Entity> all, batch;
+        while (cursor && cursor->NextBatch(batch))
+            std::move(batch.begin(), batch.end(), std::back_inserter(all));
+        return all;
+    }
+};
+
+inline std::vector<std::string> Tokenize(const std::string& q)
+{
+    std::stringstream ss(q);
+    std::string tok;
+    std::vector<std::string> tokens;
+
+    while (ss >> tok)
+        tokens.push_back(tok);
+
+    return tokens;
+}
+
+// Offset just past the n-th token Tokenize would return (npos if there are fewer), so
+// text after it can be sliced without searching for the token's spelling
+inline size_t TokenEnd(const std::string& q, size_t n)
+{
+    size_t pos = 0;
+    for (size_t i = 0; i <= n; ++i)
+    {
+        pos = q.find_first_not_of(" \t\n\v\f\r", pos);
+        if (pos == std::string::npos) return std::string::npos;
+        pos = q.find_first_of(" \t\n\v\f\r", pos);
+        if (pos == std::string::npos) return i == n ? q.size() : std::string::npos;
+    }
+    return pos;
+}
+
+/* =======================
+   QUERY PARSING
+   ======================= */
+
+struct QueryToken
+{
+    enum class Kind { Word, String, Symbol, End };
+
+    Kind kind = Kind::End;
+    std::string text;
+};
+
+// Splits query text into words, quoted strings and operator symbols.
+// Quoted strings may contain spaces; a '-' directly before a digit starts a number.
+inline std::vector<QueryToken> LexQuery(const std::string& text)
+{
+    static const std::string symbolChars = "=!<>,()+-*/";
+    std::vector<QueryToken> out;
+    size_t i = 0;
+
+    while (i < text.size())
+    {
+        char c = text[i];
+        if (isspace((unsigned char)c)) { ++i; continue; }
+
+        if (c == '"' || c == '\'')
+        {
+            size_t end = text.find(c, i + 1);
+            if (end == std::string::npos)
+                throw std::runtime_error("Unterminated string in query");
+            out.push_back({ QueryToken::Kind::String, text.substr(i + 1, end - i - 1) });
+            i = end + 1;
+            continue;
+        }
+
+        bool negativeNumber = c == '-' && i + 1 < text.size() && isdigit((unsigned char)text[i + 1])
+            && (out.empty() || out.back().kind == QueryToken::Kind::Symbol);
+
+        if (symbolChars.find(c) != std::string::npos && !negativeNumber)
+        {
+            std::string sym(1, c);
+            if (i + 1 < text.size())
+            {
+                std::string two = text.substr(i, 2);
+                if (two == "<=" || two == ">=" || two == "!=" || two == "<>") sym = two;
+            }
+            out.push_back({ QueryToken::Kind::Symbol, sym });
+            i += sym.size();
+            continue;
+        }
+
+        size_t start = i++;
+        while (i < text.size() && !isspace((unsigned char)text[i])
+            && text[i] != '"' && text[i] != '\''
+            && symbolChars.find(text[i]) == std::string::npos)
+            ++i;
+        out.push_back({ QueryToken::Kind::Word, text.substr(start, i - start) });
+    }
+
+    out.push_back({ QueryToken::Kind::End, "" });
+    return out;
+}
+
+inline std::string ToUpper(std::string s)
+{
+    std::transform(s.begin(), s.end(), s.begin(), ::toupper);
+    return s;
+}
+
+class QueryParser
+{
+public:
+    explicit QueryParser(const std::string& text) : tokens(LexQuery(text)) {}
+
+    const QueryToken& Peek() const { return tokens[pos]; }
+    const QueryToken& Take() { return tokens[pos < tokens.size() - 1 ? pos++ : pos]; }
+    bool AtEnd() const { return Peek().kind == QueryToken::Kind::End; }
+
+    // Keywords are matched case-insensitively
+    bool AcceptKeyword(const std::string& kw)
+    {
+        if (Peek().kind == QueryToken::Kind::Word && ToUpper(Peek().text) == kw)
+        {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    void ExpectKeyword(const std::string& kw)
+    {
+        if (!AcceptKeyword(kw))
+            throw std::runtime_error("Expected " + kw + " near '" + Peek().text + "'");
+    }
+
+    bool AcceptSymbol(const std::string& sym)
+    {
+        if (Peek().kind == QueryToken::Kind::Symbol && Peek().text == sym)
+        {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    void ExpectSymbol(const std::string& sym)
+    {
+        if (!AcceptSymbol(sym))
+            throw std::runtime_error("Expected '" + sym + "' near '" + Peek().text + "'");
+    }
+
+    std::string ExpectWord()
+    {
+        if (Peek().kind != QueryToken::Kind::Word)
+            throw std::runtime_error("Expected a name near '" + Peek().text + "'");
+        return Take().text;
+    }
+
+    void ExpectEnd()
+    {
+        if (!AtEnd())
+            throw std::runtime_error("Unexpected '" + Peek().text + "' in query");
+    }
+
+    size_t pos = 0;
+
+private:
+    std::vector<QueryToken> tokens;
+};
+
+// One side of a comparison: either a literal value or a (possibly table-qualified) column name
+struct Operand
+{
+    bool isColumn = false;
+    std::string name;
+    json value;
+};
+
+inline Operand ParseOperand(QueryParser& p)
+{
+    Operand o;
+    const auto& tok = p.Take();
+
+    if (tok.kind == QueryToken::Kind::String)
+    {
+        o.value = tok.text;
+        return o;
+    }
+    if (tok.kind != QueryToken::Kind::Word)
+        throw std::runtime_error("Expected a column or value near '" + tok.text + "'");
+
+    // numbers, true/false and null are literals; anything else names a column
+    try { o.value = json::parse(tok.text); }
+    catch (...) { o.isColumn = true; o.name = tok.text; }
+    return o;
+}
+
+inline CompareOp ParseCompareOp(QueryParser& p)
+{
+    const auto& tok = p.Take();
+    if (tok.kind == QueryToken::Kind::Symbol)
+    {
+        if (tok.text == "=") return CompareOp::EQ;
+        if (tok.text == "!=" || tok.text == "<>") return CompareOp::NE;
+        if (tok.text == "<") return CompareOp::LT;
+        if (tok.text == "<=") return CompareOp::LE;
+        if (tok.text == ">") return CompareOp::GT;
+        if (tok.text == ">=") return CompareOp::GE;
+    }
+    throw std::runtime_error("Expected comparison operator near '" + tok.text + "'");
+}
+
+// Resolves `col` or `table.col` against the tables of the query
+inline ColumnRef ResolveColumn(const LogicalQuery& q, const std::string& name)
+{
+    auto dot = name.find('.');
+    if (dot != std::string::npos)
+    {
+        std::string tableName = name.substr(0, dot);
+        std::string col = name.substr(dot + 1);
+        for (size_t s = 0; s < q.tables.size(); ++s)
+        {
+            if (q.tables[s]->name != tableName) continue;
+            if (!q.tables[s]->HasColumn(col))
+                throw std::runtime_error("Unknown column: " + name);
+            return { static_cast<int>(s), col, q.tables[s]->ColumnIndex(col) };
+        }
+        throw std::runtime_error("Table not in query: " + tableName);
+    }
+
+    int found = -1;
+    for (size_t s = 0; s < q.tables.size(); ++s)
+    {
+        if (!q.tables[s]->HasColumn(name)) continue;
+        if (found >= 0)
+            throw std::runtime_error("Ambiguous column: " + name);
+        found = static_cast<int>(s);
+    }
+    if (found < 0)
+        throw std::runtime_error("Unknown column: " + name);
+    return { found, name, q.tables[found]->ColumnIndex(name) };
+}
+
+// cond [AND cond ...] where cond is `col op value`, `value op col` or (in ON) `col = col`
+inline void ParseConditions(QueryParser& p, LogicalQuery& q)
+{
+    do
+    {
+        Operand lhs = ParseOperand(p);
+        CompareOp op = ParseCompareOp(p);
+        Operand rhs = ParseOperand(p);
+
+        if (lhs.isColumn && rhs.isColumn)
+        {
+            if (op != CompareOp::EQ)
+                throw std::runtime_error("Only equality is supported between columns");
+            JoinCondition jc{ ResolveColumn(q, lhs.name), ResolveColumn(q, rhs.name) };
+            if (jc.left.slot == jc.right.slot)
+                throw std::runtime_error("Join condition must compare columns of different tables");
+            q.joins.push_back(std::move(jc));
+        }
+        else if (lhs.isColumn)
+            q.filters.push_back({ ResolveColumn(q, lhs.name), op, rhs.value });
+        else if (rhs.isColumn)
+            q.filters.push_back({ ResolveColumn(q, rhs.name), FlipCompareOp(op), lhs.value });
+        else
+            throw std::runtime_error("Condition must reference a column");
+    } while (p.AcceptKeyword("AND"));
+}
+
+// Parses `Table [JOIN Table ON cond ...] [WHERE cond [AND cond ...]]`
+inline LogicalQuery ParseTableExpression(Database& db, QueryParser& p, bool allowJoins)
+{
+    LogicalQuery q;
+    q.tables.push_back(&db.GetTable(p.ExpectWord()));
+
+    while (p.AcceptKeyword("JOIN"))
+    {
+        if (!allowJoins)
+            throw std::runtime_error("JOIN is only supported in SELECT");
+        Table* t = &db.GetTable(p.ExpectWord());
+        if (std::find(q.tables.begin(), q.tables.end(), t) != q.tables.end())
+            throw std::runtime_error("Table joined twice: " + t->name);
+        q.tables.push_back(t);
+        p.ExpectKeyword("ON");
+        ParseConditions(p, q);
+    }
+
+    if (p.AcceptKeyword("WHERE"))
+        ParseConditions(p, q);
+
+    return q;
+}
+
+// col = operand [(+|-|*|/) operand], operands being literals or columns of the row
+struct SetClause
+{
+    std::string column;
+    Operand lhs;
+    char op = 0;
+    Operand rhs;
+};
+
+inline std::vector<SetClause> ParseSetClauses(QueryParser& p, const Table& table)
+{
+    std::vector<SetClause> sets;
+    do
+    {
+        SetClause sc;
+        sc.column = p.ExpectWord();
+        if (!table.HasColumn(sc.column))
+            throw std::runtime_error("Unknown column: " + sc.column);
+        p.ExpectSymbol("=");
+
+        sc.lhs = ParseOperand(p);
+        for (const char* op : { "+", "-", "*", "/" })
+        {
+            if (p.AcceptSymbol(op))
+            {
+                sc.op = op[0];
+                sc.rhs = ParseOperand(p);
+                break;
+            }
+        }
+
+        for (const Operand* o : { &sc.lhs, &sc.rhs })
+            if (o->isColumn && !table.HasColumn(o->name))
+                throw std::runtime_error("Unknown column: " + o->name);
+
+        sets.push_back(std::move(sc));
+    } while (p.AcceptSymbol(","));
+    return sets;
+}
+
+inline json EvaluateSetClause(const SetClause& sc, const Table& table, size_t row)
+{
+    auto operandValue = [&](const Operand& o) -> json {
+        return o.isColumn ? table.GetValue(row, o.name) : o.value;
+    };
+
+    json a = operandValue(sc.lhs);
+    if (!sc.op) return a;
+    json b = operandValue(sc.rhs);
+
+    if (a.is_null() || b.is_null()) return json();
+
+    if (sc.op == '+' && a.is_string() && b.is_string())
+        return a.get<std::string>() + b.get<std::string>();
+
+    if (!a.is_number() || !b.is_number())
+        throw std::runtime_error(std::string("Cannot apply '") + sc.op + "' to " + a.dump() + " and " + b.dump());
+
+    if (a.is_number_integer() && b.is_number_integer())
+    {
+        int64_t x = a.get<int64_t>(), y = b.get<int64_t>(), r = 0;
+        bool overflow = false;
+        switch (sc.op)
+        {
+        case '+': overflow = __builtin_add_overflow(x, y, &r); break;
+        case '-': overflow = __builtin_sub_overflow(x, y, &r); break;
+        case '*': overflow = __builtin_mul_overflow(x, y, &r); break;
+        default:
+            if (y == 0) throw std::runtime_error("Division by zero in SET " + sc.column);
+            overflow = x == std::numeric_limits<int64_t>::min() && y == -1;
+            if (!overflow) r = x / y;
+        }
+        if (overflow) throw std::runtime_error("Integer overflow in SET " + sc.column);
+        return r;
+    }
+
+    double x = a.get<double>(), y = b.get<double>();
+    switch (sc.op)
+    {
+    case '+': return x + y;
+    case '-': return x - y;
+    case '*': return x * y;
+    default:
+        if (y == 0.0) throw std::runtime_error("Division by zero in SET " + sc.column);
+        return x / y;
+    }
+}
+
+/* =======================
+   PLAN EXECUTION
+   ======================= */
+
+// Operator names as a nested expression, e.g. "HashJoin(SeqScan a, IndexLookup b.id)"
+inline std::string DescribePlanShape(const PhysicalOperator& op)
+{
+    std::string s = op.Name();
+    for (size_t i = 0; i < op.children.size(); ++i)
+        s += (i ? ", " : "(") + DescribePlanShape(*op.children[i]);
+    return op.children.empty() ? s : s + ")";
+}
+
+// Adds a finished plan's work to the current thread's execution counters: rows read by
+// the leaf operators and index entries followed anywhere in the plan
+inline void AddPlanCounters(const PhysicalOperator& op)
+{
+    if (op.children.empty())
+        tl_executionCounters.rowsScanned += op.metrics.rowsIn;
+    tl_executionCounters.indexHits += op.metrics.indexHits;
+    for (const auto& c : op.children)
+        AddPlanCounters(*c);
+}
+
+inline void CountPlanWork(const PhysicalOperator& root)
+{
+    AddPlanCounters(root);
+    if (GlobalSlowQueryLog().Enabled())
+        tl_executedPlans += (tl_executedPlans.empty() ? "" : "; ") + DescribePlanShape(root);
+}
+
+// Runs a plan and returns the matching row ids for its first table
+inline std::vector<size_t> CollectRowIds(PhysicalPlan& plan)
+{
+    TRACE_SPAN("CollectRowIds");
+    std::vector<size_t> ids;
+    TupleBatch batch(plan.tables->size());
+    plan.root->Open();
+    while (plan.root->NextBatch(batch))
+        for (uint32_t pos : batch.sel)
+            ids.push_back(batch.ids[0][pos]);
+    CountPlanWork(*plan.root);
+    return ids;
+}
+
+// Copies out one result row. Single-table results keep plain column names;
+// joined rows name every column `table.column`.
+inline Entity MaterializeTuple(const TableList& tables, const TupleBatch& b, size_t pos)
+{
+    if (tables.size() == 1)
+        return tables[0]->GetRow(b.ids[0][pos]);
+
+    Entity row;
+    for (size_t s = 0; s < tables.size(); ++s)
+    {
+        const Table& table = *tables[s];
+        for (size_t c = 0; c < table.schema.size(); ++c)
+            row.fields[table.name + "." + table.schema[c].name] = Value(table.schema[c].type, table.GetValue(b.ids[s][pos], c));
+    }
+    return row;
+}
+
+// Names MaterializeTuple gives the columns, in schema order
+inline std::vector<std::string> ResultColumns(const TableList& tables)
+{
+    std::vector<std::string> cols;
+    for (const Table* table : tables)
+        for (const auto& a : table->schema)
+            cols.push_back(tables.size() == 1 ? a.name : table->name + "." + a.name);
+    return cols;
+}
+
+// Streams the output of a plan, one operator batch per result batch; the plan is
+// opened on the first pull
+class PlanCursor : public RowCursor
+{
+public:
+    explicit PlanCursor(PhysicalPlan p) : plan(std::move(p)), tuples(plan.tables->size()) {}
+
+    // a result abandoned part way still counts the work done so far
+    ~PlanCursor() override { Finish(); }
+
+    bool NextBatch(std::vector<Entity>& batch) override
+    {
+        batch.clear();
+        if (done) return false;
+        TRACE_SPAN("PlanCursor::NextBatch");
+        if (!opened)
+        {
+            plan.root->Open();
+            opened = true;
+        }
+
+        if (!plan.root->NextBatch(tuples))
+        {
+            Finish();
+            return false;
+        }
+        batch.reserve(tuples.Size());
+        for (uint32_t pos : tuples.sel)
+            batch.push_back(MaterializeTuple(*plan.tables, tuples, pos));
+        return true;
+    }
+
+    PhysicalPlan plan;
+
+private:
+    void Finish()
+    {
+        if (opened && !done && plan.root) CountPlanWork(*plan.root);
+        done = true;
+    }
+
+    TupleBatch tuples;
+    bool opened = false;
+    bool done = false;
+};
+
+/* =======================
+   RESULT CACHE LOOKUP
+   ======================= */
+
+// Cache key of a SELECT: its tokens, so spacing and keyword case do not matter but
+// literals, table and column names keep their case
+inline std::string NormalizedQueryKey(const std::string& query)
+{
+    static const std::unordered_set<std::string> keywords = { "SELECT", "JOIN", "ON", "WHERE", "AND" };
+    std::string key;
+    for (const auto& tok : LexQuery(query))
+    {
+        if (tok.kind == QueryToken::Kind::End) break;
+        key += static_cast<char>('0' + static_cast<int>(tok.kind));
+        if (tok.kind == QueryToken::Kind::Word && keywords.count(ToUpper(tok.text)))
+            key += ToUpper(tok.text);
+        else
+            key += tok.text;
+        key += '\x1f';
+    }
+    return key;
+}
+
+// Serves a cached result. TakeSharedRows hands out the cache's own rows without copying;
+// NextBatch has to copy them, since its caller owns the batch.
+class CachedRowsCursor : public RowCursor
+{
+public:
+    explicit CachedRowsCursor(std::shared_ptr<const CachedResult> r) : result(std::move(r)) {}
+
+    bool NextBatch(std::vector<Entity>& batch) override
+    {
+        batch.clear();
+        size_t end = std::min(result->rows.size(), pos + kResultBatchSize);
+        batch.insert(batch.end(), result->rows.begin() + pos, result->rows.begin() + end);
+        pos = end;
+        return !batch.empty();
+    }
+
+    const std::vector<Entity>* TakeSharedRows() override
+    {
+        if (pos != 0) return nullptr;
+        pos = result->rows.size();
+        return &result->rows;
+    }
+
+private:
+    std::shared_ptr<const CachedResult> result;
+    size_t pos = 0;
+};
+
+// Passes a plan's batches through and keeps a copy of them; once the plan is exhausted
+// the whole result goes into the cache. Results that outgrow the cache's entry limit
+// stop being copied, and a result abandoned part way is not cached.
+class CachingCursor : public RowCursor
+{
+public:
+    CachingCursor(std::unique_ptr<PlanCursor> in, std::string key, std::shared_ptr<CachedResult> entry)
+        : input(std::move(in)), key(std::move(key)), entry(std::move(entry)),
+          limit(GlobalResultCache().MaxEntryBytes())
+    {
+        this->entry->bytes = sizeof(CachedResult) + 2 * this->key.size();
+    }
+
+    bool NextBatch(std::vector<Entity>& batch) override
+    {
+        if (!input->NextBatch(batch))
+        {
+            if (entry)
+            {
+                GlobalResultCache().Insert(key, std::move(entry));
+                entry.reset();
+            }
+            return false;
+        }
+
+        if (entry)
+        {
+            for (const auto& row : batch)
+                entry->bytes += EstimateEntityBytes(row);
+            if (entry->bytes > limit)
+                entry.reset();
+            else
+                entry->rows.insert(entry->rows.end(), batch.begin(), batch.end());
+        }
+        return true;
+    }
+
+private:
+    std::unique_ptr<PlanCursor> input;
+    std::string key;
+    std::shared_ptr<CachedResult> entry;
+    size_t limit;
+};
+
+// Tombstones the rows a single-table plan produces and returns how many there were.
+// Copies of the removed rows are only made when `returning` is given.
+// Storage is reclaimed once enough of the table is dead (see MaybeCompact).
+inline size_t RemoveRows(Table& table, PhysicalPlan& plan, std::vector<Entity>* returning = nullptr)
+{
+    auto ids = CollectRowIds(plan);
+
+    if (returning)
+    {
+        returning->reserve(returning->size() + ids.size());
+        for (size_t id : ids)
+            returning->push_back(table.GetRow(id));
+    }
+
+    for (size_t id : ids)
+        RemoveRow(table, id);
+    if (!ids.empty()) table.Touch();
+
+    MaybeCompact(table);
+    return ids.size();
+}
+
+// Empties a table and releases its storage pages (rows are copied out only for RETURNING)
+inline size_t RemoveAllRows(Table& table, std::vector<Entity>* returning = nullptr)
+{
+    size_t n = table.LiveRowCount();
+
+    if (returning)
+    {
+        returning->reserve(returning->size() + n);
+        for (size_t i = 0; i < table.RowCount(); ++i)
+            if (!table.IsDeleted(i)) returning->push_back(table.GetRow(i));
+    }
+
+    table.storage.Clear();
+    std::vector<uint64_t>().swap(table.deleted);
+    table.deletedCount = 0;
+    table.Touch();
+    RebuildIndexes(table);
+    return n;
+}
+
+// Updates the rows a single-table plan produces in place. All new values are computed
+// and checked (NOT NULL, primary key uniqueness) before any row changes, and only
+// indexes on columns whose value actually changed are touched.
+inline size_t UpdateRows(Table& table, PhysicalPlan& plan, const std::vector<SetClause>& sets)
+{
+    auto ids = CollectRowIds(plan);
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    std::vector<const Attribute*> attrs;
+    std::vector<size_t> cols;
+    for (const auto& sc : sets)
+    {
+        cols.push_back(table.ColumnIndex(sc.column));
+        attrs.push_back(&table.schema[cols.back()]);
+    }
+
+    // newValues[i][k] = value of sets[k] for row ids[i]
+    std::vector<std::vector<json>> newValues(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        newValues[i].reserve(sets.size());
+        for (size_t k = 0; k < sets.size(); ++k)
+            newValues[i].push_back(CoerceValue(*attrs[k], EvaluateSetClause(sets[k], table, ids[i])));
+    }
+
+    for (size_t k = 0; k < sets.size(); ++k)
+    {
+        const Attribute* attr = attrs[k];
+
+        if (attr->isNotNull)
+        {
+            for (const auto& nv : newValues)
+                if (nv[k].is_null())
+                    throw std::runtime_error("Column cannot be null: " + attr->name);
+        }
+
+        if (attr->isPrimaryKey)
+        {
+            // a new key may only collide with a row that is itself being re-keyed
+            const Index* idx = table.FindIndex(attr->name);
+            std::unordered_set<json, JsonKeyHash> seen;
+            for (const auto& nv : newValues)
+            {
+                if (!seen.insert(nv[k]).second)
+                    throw std::runtime_error("Duplicate primary key: " + attr->name);
+                const auto* hits = idx ? idx->Find(nv[k]) : nullptr;
+                if (!hits) continue;
+                for (size_t h : *hits)
+                    if (!table.IsDeleted(h) && !std::binary_search(ids.begin(), ids.end(), h))
+                        throw std::runtime_error("Duplicate primary key: " + attr->name);
+            }
+        }
+    }
+
+    std::unordered_map<std::string, std::vector<IndexKeyChange>> indexChanges;
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        for (size_t k = 0; k < sets.size(); ++k)
+        {
+            json old = table.GetValue(ids[i], cols[k]);
+            if (old == newValues[i][k]) continue;
+
+            if (table.indexes.count(sets[k].column))
+                indexChanges[sets[k].column].push_back({ ids[i], std::move(old), newValues[i][k] });
+
+            // keep AUTO_INCREMENT ahead of explicitly assigned values
+            auto counter = table.autoIncCounters.find(sets[k].column);
+            if (counter != table.autoIncCounters.end() && newValues[i][k].is_number_integer())
+                counter->second = std::max(counter->second, newValues[i][k].get<int64_t>() + 1);
+
+            table.storage.Set(ids[i], cols[k], newValues[i][k]);
+        }
+    }
+    table.Touch();
+
+    for (auto& [col, changes] : indexChanges)
+        ApplyIndexKeyChanges(table.indexes.at(col), changes);
+
+    return ids.size();
+}
+
+// A parsed and planned SELECT or REMOVE; EXPLAIN uses the same path as execution
+struct PlannedStatement
+{
+    std::string verb;
+    LogicalQuery logical;
+    PhysicalPlan plan;
+    bool returning = false;  // REMOVE ... RETURNING
+};
+
+inline PlannedStatement PlanStatement(Database& db, QueryParser& parser)
+{
+    TRACE_SPAN("PlanStatement");
+    PlannedStatement st;
+    st.verb = ToUpper(parser.ExpectWord());
+    if (st.verb != "SELECT" && st.verb != "REMOVE")
+        throw std::runtime_error("Cannot plan " + st.verb + " statements");
+
+    st.logical = ParseTableExpression(db, parser, st.verb == "SELECT");
+    if (st.verb == "REMOVE")
+        st.returning = parser.AcceptKeyword("RETURNING");
+    parser.ExpectEnd();
+
+    st.plan = PlanQuery(st.logical);
+    return st;
+}
+
+// One row per operator, depth-first, with estimates and (after a run) actual metrics
+inline void DescribePlan(const PhysicalOperator& op, int depth, bool analyzed, std::vector<Entity>& out)
+{
+    Entity row;
+    row.fields["step"] = Value(DType::INT, out.size() + 1);
+    row.fields["operator"] = Value(DType::TEXT, std::string(depth * 2, ' ') + (depth ? "-> " : "") + op.Name());
+    row.fields["detail"] = Value(DType::TEXT, op.Detail());
+    row.fields["est_rows"] = Value(DType::REAL, std::round(op.estimatedRows * 100.0) / 100.0);
+    row.fields["est_cost"] = Value(DType::REAL, std::round(op.estimatedCost * 100.0) / 100.0);
+
+    if (analyzed)
+    {
+        const auto& m = op.metrics;
+        row.fields["rows_in"] = Value(DType::INT, m.rowsIn);
+        row.fields["rows_out"] = Value(DType::INT, m.rowsOut);
+        row.fields["index_hits"] = Value(DType::INT, m.indexHits);
+        row.fields["groups_skipped"] = Value(DType::INT, m.groupsSkipped);
+        row.fields["time_ms"] = Value(DType::REAL, static_cast<double>(m.nanos) / 1e6);
+        row.fields["bytes_alloc"] = Value(DType::INT, m.bytesAllocated);
+    }
+
+    out.push_back(std::move(row));
+    for (const auto& c : op.children)
+        DescribePlan(*c, depth + 1, analyzed, out);
+}
+
+inline QueryResult ExecuteQuery(Database& db, const std::string& query)
+{
+    TRACE_SPAN_ARG("ExecuteQuery", query);
+    auto tokens = Tokenize(query);
+
+    if (tokens.empty())
+        throw std::runtime_error("Empty query");
+
+    if (GlobalWorkloadCapture().Enabled() && !IsInstrumentationCommand(tokens[0]))
+        GlobalWorkloadCapture().Record(query);
+
+    /* -------- CREATE --------
+       CREATE TABLE Name (col TYPE, ...)
+    */
+    if (tokens[0] == "CREATE")
+    {
+        /* CREATE INDEX ON Table (col) */
+        if (tokens.size() >= 2 && tokens[1] == "INDEX")
+        {
+            QueryParser parser(query);
+            parser.ExpectKeyword("CREATE");
+            parser.ExpectKeyword("INDEX");
+            parser.ExpectKeyword("ON");
+            auto& table = db.GetTable(parser.ExpectWord());
+            parser.ExpectSymbol("(");
+            std::string column = parser.ExpectWord();
+            parser.ExpectSymbol(")");
+            parser.ExpectEnd();
+
+            CreateIndex(table, column);
+            return {};
+        }
+
+        if (tokens.size() < 3 || tokens[1] != "TABLE")
+            throw std::runtime_error("Invalid CREATE syntax");
+
+        auto parenStart = query.find('(');
+        auto parenEnd = query.rfind(')');
+        if (parenStart == std::string::npos || parenEnd == std::string::npos || parenEnd < parenStart)
+            throw std::runtime_error("CREATE TABLE requires column definitions in parentheses");
+
+        std::string tableName = tokens[2];
+
+        if (db.GetTables().find(tableName) != db.GetTables().end())
+            throw std::runtime_error("Table already exists: " + tableName);
+
+        auto& table = db.CreateTable(tableName);
+
+        auto colsText = query.substr(parenStart + 1, parenEnd - parenStart - 1);
+        std::stringstream ss(colsText);
+        std::string colDef;
+        while (std::getline(ss, colDef, ','))
+        {
+            auto l = colDef.find_first_not_of(" \t\n\r");
+            auto r = colDef.find_last_not_of(" \t\n\r");
+            if (l == std::string::npos) continue;
+            std::string def = colDef.substr(l, r - l + 1);
+
+            std::stringstream ds(def);
+            std::string colName, typeStr;
+            ds >> colName >> typeStr;
+            if (colName.empty() || typeStr.empty())
+                throw std::runtime_error("Invalid column definition: " + def);
+
+            // remainder contains modifiers like PRIMARY KEY, AUTO_INCREMENT, NOT NULL, DEFAULT ...
+            auto posAfterType = def.find(typeStr);
+            std::string modifiers = "";
+            if (posAfterType != std::string::npos)
+                modifiers = def.substr(posAfterType + typeStr.size());
+
+            std::transform(typeStr.begin(), typeStr.end(), typeStr.begin(), ::toupper);
+
+            DType dtype;
+            if (typeStr == "TEXT") dtype = DType::TEXT;
+            else if (typeStr == "CHAR") dtype = DType::CHAR;
+            else if (typeStr == "INT") dtype = DType::INT;
+            else if (typeStr == "FLOAT") dtype = DType::FLOAT;
+            else if (typeStr == "REAL") dtype = DType::REAL;
+            else if (typeStr == "RELATION") dtype = DType::RELATION;
+            else throw std::runtime_error("Unknown type: " + typeStr);
+
+            Attribute attr(colName, dtype);
+
+            // parse modifiers (case-insensitive)
+            std::string up = modifiers;
+            std::transform(up.begin(), up.end(), up.begin(), ::toupper);
+
+            if (up.find("AUTO") != std::string::npos)
+                attr.isAutoIncrement = true;
+            if (up.find("PRIMARY") != std::string::npos && up.find("KEY") != std::string::npos)
+                attr.isPrimaryKey = true;
+            if (up.find("NOT") != std::string::npos && up.find("NULL") != std::string::npos)
+                attr.isNotNull = true;
+
+            // DEFAULT parsing: find 'DEFAULT' and extract the following token (allow quoted strings)
+            auto defPos = up.find("DEFAULT");
+            if (defPos != std::string::npos)
+            {
+                // find original 'DEFAULT' position in modifiers to get original-case token
+                auto origDefPos = modifiers.find_first_of("DEFAULT");
+                if (origDefPos == std::string::npos) origDefPos = defPos; // fallback
+                size_t vpos = origDefPos + 7; // length of DEFAULT
+                // skip whitespace
+                while (vpos < modifiers.size() && isspace((unsigned char)modifiers[vpos])) ++vpos;
+                if (vpos < modifiers.size())
+                {
+                    if (modifiers[vpos] == '"')
+                    {
+                        size_t endq = modifiers.find('"', vpos + 1);
+                        if (endq == std::string::npos) throw std::runtime_error("Unterminated DEFAULT string in: " + def);
+                        std::string dv = modifiers.substr(vpos + 1, endq - vpos - 1);
+                        attr.hasDefault = true;
+                        attr.defaultValue = dv;
+                    }
+                    else
+                    {
+                        // read until space or end
+                        size_t endv = vpos;
+                        while (endv < modifiers.size() && !isspace((unsigned char)modifiers[endv])) ++endv;
+                        std::string dv = modifiers.substr(vpos, endv - vpos);
+                        // try to parse as json (numbers, booleans), fall back to string
+                        try { attr.defaultValue = json::parse(dv); }
+                        catch (...) { attr.defaultValue = dv; }
+                        attr.hasDefault = true;
+                    }
+                }
+            }
+
+            table.AddColumn(attr);
+
+            if (attr.isAutoIncrement)
+                table.autoIncCounters[attr.name] = 1; // initialize counter
+        }
+
+        // primary keys are always backed by a hash index
+        for (const auto& attr : table.schema)
+            if (attr.isPrimaryKey) CreateIndex(table, attr.name);
+
+        return {};
+    }
+
+    /* -------- INSERT --------
+       INSERT TableName {json}
+       INSERT TableName [{json}, {json}, ...]
+       INSERT TableName FROM 'file.jsonl'
+    */
+    if (tokens[0] == "INSERT")
+    {
+        if (tokens.size() < 2)
+            throw std::runtime_error("Invalid INSERT syntax");
+
+        auto& table = db.GetTable(tokens[1]);
+
+        if (tokens.size() >= 3 && ToUpper(tokens[2]) == "FROM")
+        {
+            QueryParser parser(query);
+            parser.ExpectKeyword("INSERT");
+            parser.ExpectWord();
+            parser.ExpectKeyword("FROM");
+            const auto& pathTok = parser.Take();
+            if (pathTok.kind != QueryToken::Kind::String)
+                throw std::runtime_error("INSERT ... FROM requires a quoted file path");
+            std::string path = pathTok.text;
+            parser.ExpectEnd();
+
+            std::ifstream file(path);
+            if (!file)
+                throw std::runtime_error("Cannot open file: " + path);
+
+            // one JSON object per line; blank lines are skipped
+            std::string line;
+            size_t lineNo = 0;
+            size_t n = InsertBatch(table, [&](json& out) {
+                while (std::getline(file, line))
+                {
+                    ++lineNo;
+                    if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+                    try { out = json::parse(line); }
+                    catch (const json::parse_error& e)
+                    {
+                        throw std::runtime_error(path + ":" + std::to_string(lineNo) + ": " + e.what());
+                    }
+                    return true;
+                }
+                return false;
+            });
+            return QueryResult::Affected(n);
+        }
+
+        auto bodyStart = query.find_first_of("{[", TokenEnd(query, 1));
+        if (bodyStart != std::string::npos && query[bodyStart] == '[')
+        {
+            auto bodyEnd = query.rfind(']');
+            json values = json::parse(query.substr(bodyStart, bodyEnd - bodyStart + 1));
+            return QueryResult::Affected(InsertArray(table, values));
+        }
+
+        auto jsonStart = query.find('{');
+        auto jsonEnd   = query.rfind('}');
+
+        if (jsonStart == std::string::npos || jsonEnd == std::string::npos)
+            throw std::runtime_error("INSERT requires JSON object");
+
+        auto jsonText = query.substr(jsonStart, jsonEnd - jsonStart + 1);
+        json values = json::parse(jsonText);
+
+        Insert(table, values);
+        return {};
+    }
+
+    /* -------- SELECT --------
+       SELECT Table
+       SELECT Table WHERE col op value [AND ...]
+       SELECT Table JOIN Other ON Table.col = Other.col [JOIN ...] [WHERE ...]
+    */
+    if (tokens[0] == "SELECT")
+    {
+        if (tokens.size() < 2)
+            throw std::runtime_error("Invalid SELECT syntax");
+
+        QueryResult result;
+        result.hasResult = true;
+
+        auto& cache = GlobalResultCache();
+        std::string key;
+        if (cache.Enabled())
+        {
+            key = NormalizedQueryKey(query);
+            if (auto hit = cache.Lookup(db, key))
+            {
+                ++tl_executionCounters.cacheHits;
+                result.columns = hit->columns;
+                result.cursor = std::make_shared<CachedRowsCursor>(std::move(hit));
+                return result;
+            }
+            ++tl_executionCounters.cacheMisses;
+        }
+
+        QueryParser parser(query);
+        auto st = PlanStatement(db, parser);
+        result.columns = ResultColumns(*st.plan.tables);
+
+        if (key.empty())
+        {
+            result.cursor = std::make_shared<PlanCursor>(std::move(st.plan));
+            return result;
+        }
+
+        // the versions read now are the ones the result reflects
+        auto entry = std::make_shared<CachedResult>();
+        entry->columns = result.columns;
+        for (const Table* table : *st.plan.tables)
+            entry->tables.emplace_back(table->name, table->version);
+        result.cursor = std::make_shared<CachingCursor>(
+            std::make_unique<PlanCursor>(std::move(st.plan)), std::move(key), std::move(entry));
+        return result;
+    }
+
+    /* -------- REMOVE --------
+       REMOVE Table [RETURNING]
+       REMOVE Table WHERE col op value [AND ...] [RETURNING]
+       Returns the number of removed rows; RETURNING returns the rows themselves.
+    */
+    if (tokens[0] == "REMOVE")
+    {
+        if (tokens.size() < 2)
+            throw std::runtime_error("Invalid REMOVE syntax");
+
+        QueryParser parser(query);
+        auto st = PlanStatement(db, parser);
+        auto& table = *st.logical.tables[0];
+
+        std::vector<Entity> removed;
+        std::vector<Entity>* returning = st.returning ? &removed : nullptr;
+
+        size_t n = st.logical.filters.empty()
+            ? RemoveAllRows(table, returning)
+            : RemoveRows(table, st.plan, returning);
+
+        if (returning)
+        {
+            auto result = QueryResult::FromRows(std::move(removed));
+            result.columns = ResultColumns(*st.plan.tables);
+            return result;
+        }
+        return QueryResult::Affected(n);
+    }
+
+    /* -------- UPDATE --------
+       UPDATE Table SET col = expr [, col = expr ...] [WHERE col op value [AND ...]]
+    */
+    if (tokens[0] == "UPDATE")
+    {
+        QueryParser parser(query);
+        parser.ExpectKeyword("UPDATE");
+
+        LogicalQuery logical;
+        logical.tables.push_back(&db.GetTable(parser.ExpectWord()));
+        Table& table = *logical.tables[0];
+
+        parser.ExpectKeyword("SET");
+        auto sets = ParseSetClauses(parser, table);
+        if (parser.AcceptKeyword("WHERE"))
+            ParseConditions(parser, logical);
+        parser.ExpectEnd();
+
+        auto plan = PlanQuery(logical);
+        return QueryResult::Affected(UpdateRows(table, plan, sets));
+    }
+
+    /* -------- COMPACT --------
+       COMPACT Table   reclaim storage of removed rows now instead of at the threshold
+    */
+    if (tokens[0] == "COMPACT")
+    {
+        if (tokens.size() != 2)
+            throw std::runtime_error("Invalid COMPACT syntax");
+
+        auto& table = db.GetTable(tokens[1]);
+        size_t reclaimed = table.deletedCount;
+        CompactTable(table);
+        return QueryResult::Affected(reclaimed);
+    }
+
+    /* -------- DROP --------
+       DROP TABLE Table   delete a table and return its storage to the OS
+    */
+    if (tokens[0] == "DROP")
+    {
+        if (tokens.size() != 3 || ToUpper(tokens[1]) != "TABLE")
+            throw std::runtime_error("Invalid DROP syntax");
+
+        for (const auto& [name, other] : db.GetTables())
+            for (const auto& fk : other->foreignKeys)
+                if (fk.refTable == tokens[2] && name != tokens[2])
+                    throw std::runtime_error("Table " + tokens[2] + " is referenced by " + name);
+
+        size_t n = db.GetTable(tokens[2]).LiveRowCount();
+        db.DropTable(tokens[2]);
+        return QueryResult::Affected(n);
+    }
+
+    /* -------- STORAGE --------
+       STORAGE          memory held by every table's row storage
+       STORAGE Table
+    */
+    if (tokens[0] == "STORAGE")
+    {
+        std::vector<const Table*> targets;
+        if (tokens.size() >= 2)
+            targets.push_back(&db.GetTable(tokens[1]));
+        else
+            for (const auto& [name, table] : db.GetTables())
+                targets.push_back(table.get());
+
+        std::vector<Entity> rows;
+        for (const Table* table : targets)
+        {
+            StorageUsage u = MeasureStorage(*table);
+            Entity row;
+            row.fields["table"] = Value(DType::TEXT, table->name);
+            row.fields["rows"] = Value(DType::INT, table->LiveRowCount());
+            row.fields["dead_rows"] = Value(DType::INT, table->deletedCount);
+            row.fields["pages"] = Value(DType::INT, u.pages);
+            row.fields["reserved_bytes"] = Value(DType::INT, u.reservedBytes);
+            row.fields["live_bytes"] = Value(DType::INT, u.liveBytes);
+            row.fields["free_list_bytes"] = Value(DType::INT, u.freeListBytes);
+            row.fields["fragmentation"] = Value(DType::REAL, u.Fragmentation());
+
+            std::string dictColumns;
+            for (size_t c = 0; c < table->schema.size(); ++c)
+            {
+                if (!table->storage.Column(c).dictionary) continue;
+                if (!dictColumns.empty()) dictColumns += ",";
+                dictColumns += table->schema[c].name;
+            }
+            row.fields["dict_columns"] = Value(DType::TEXT, dictColumns);
+
+            // INT columns with at least one compressed row group
+            std::string packedColumns;
+            for (size_t c = 0; c < table->schema.size(); ++c)
+            {
+                const auto& st = table->storage;
+                bool any = false;
+                for (size_t g = 0; g < st.GroupCount() && !any; ++g)
+                    any = st.Kind(c) == StorageKind::Int64 && st.Chunk(g, c).encoding != IntEncoding::Plain;
+                if (!any) continue;
+                if (!packedColumns.empty()) packedColumns += ",";
+                packedColumns += table->schema[c].name;
+            }
+            row.fields["packed_columns"] = Value(DType::TEXT, packedColumns);
+            rows.push_back(std::move(row));
+        }
+        return QueryResult::FromRows(std::move(rows), {
+            "table", "rows", "dead_rows", "pages", "reserved_bytes", "live_bytes", "free_list_bytes",
+            "fragmentation", "dict_columns", "packed_columns" });
+    }
+
+    /* -------- MEMORY --------
+       MEMORY [Table]   bytes held per table: rows, strings, indexes, tombstones, overhead
+    */
+    if (tokens[0] == "MEMORY")
+    {
+        std::vector<const Table*> targets;
+        if (tokens.size() >= 2)
+            targets.push_back(&db.GetTable(tokens[1]));
+        else
+            for (const auto& [name, table] : db.GetTables())
+                targets.push_back(table.get());
+
+        // largest first, the order in which to consider compressing or evicting
+        std::vector<std::pair<const Table*, MemoryUsage>> usage;
+        for (const Table* table : targets)
+            usage.emplace_back(table, MeasureMemory(*table));
+        std::sort(usage.begin(), usage.end(),
+            [](const auto& a, const auto& b) { return a.second.Total() > b.second.Total(); });
+
+        std::vector<Entity> rows;
+        for (const auto& [table, u] : usage)
+        {
+            Entity row;
+            row.fields["table"] = Value(DType::TEXT, table->name);
+            row.fields["rows"] = Value(DType::INT, table->LiveRowCount());
+            row.fields["row_bytes"] = Value(DType::INT, u.rowBytes);
+            row.fields["string_bytes"] = Value(DType::INT, u.stringBytes);
+            row.fields["index_bytes"] = Value(DType::INT, u.indexBytes);
+            row.fields["tombstone_bytes"] = Value(DType::INT, u.tombstoneBytes);
+            row.fields["overhead_bytes"] = Value(DType::INT, u.overheadBytes);
+            row.fields["total_bytes"] = Value(DType::INT, u.Total());
+            rows.push_back(std::move(row));
+        }
+        return QueryResult::FromRows(std::move(rows), {
+            "table", "rows", "row_bytes", "string_bytes", "index_bytes", "tombstone_bytes", "overhead_bytes", "total_bytes" });
+    }
+
+    /* -------- EXPLAIN --------
+       EXPLAIN <SELECT|REMOVE ...>          show the chosen plan
+       EXPLAIN ANALYZE <SELECT|REMOVE ...>  run it and report per-operator metrics
+    */
+    if (tokens[0] == "EXPLAIN")
+    {
+        QueryParser parser(query);
+        parser.ExpectKeyword("EXPLAIN");
+        bool analyze = parser.AcceptKeyword("ANALYZE");
+        auto st = PlanStatement(db, parser);
+
+        std::vector<Entity> rows;
+
+        if (!analyze)
+        {
+            DescribePlan(*st.plan.root, 0, false, rows);
+            return QueryResult::FromRows(std::move(rows), { "step", "operator", "detail", "est_rows", "est_cost" });
+        }
+
+        EnableInstrumentation(*st.plan.root);
+        auto start = std::chrono::steady_clock::now();
+        uint64_t bytes = ThreadAllocatedBytes();
+
+        // results are pulled and dropped batch by batch, as a client would consume them;
+        // a REMOVE takes the same path as the statement itself
+        size_t produced = 0;
+        if (st.verb == "REMOVE")
+        {
+            auto& table = *st.logical.tables[0];
+            produced = st.logical.filters.empty() ? RemoveAllRows(table) : RemoveRows(table, st.plan);
+        }
+        else
+        {
+            PlanCursor cursor(std::move(st.plan));
+            std::vector<Entity> batch;
+            while (cursor.NextBatch(batch))
+                produced += batch.size();
+            st.plan = std::move(cursor.plan);
+        }
+
+        uint64_t totalBytes = ThreadAllocatedBytes() - bytes;
+        double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        DescribePlan(*st.plan.root, 0, true, rows);
+
+        Entity total;
+        total.fields["step"] = Value(DType::INT, rows.size() + 1);
+        total.fields["operator"] = Value(DType::TEXT, "Total (" + st.verb + ")");
+        total.fields["rows_out"] = Value(DType::INT, produced);
+        total.fields["time_ms"] = Value(DType::REAL, totalMs);
+        total.fields["bytes_alloc"] = Value(DType::INT, totalBytes);
+        rows.push_back(std::move(total));
+        return QueryResult::FromRows(std::move(rows), {
+            "step", "operator", "detail", "est_rows", "est_cost", "rows_in", "rows_out", "index_hits",
+            "groups_skipped", "time_ms", "bytes_alloc" });
+    }
+
+    /* -------- ANALYZE --------
+       ANALYZE
+       ANALYZE Table
+    */
+    if (tokens[0] == "ANALYZE")
+    {
+        std::vector<Table*> targets;
+        if (tokens.size() >= 2)
+            targets.push_back(&db.GetTable(tokens[1]));
+        else
+            for (const auto& [name, table] : db.GetTables())
+                targets.push_back(table.get());
+
+        std::vector<Entity> rows;
+
+        for (Table* table : targets)
+        {
+            Analyze(*table);
+
+            // one summary row per column so the gathered numbers are visible
+            for (const auto& attr : table->schema)
+            {
+                const auto& cs = table->stats.columns.at(attr.name);
+                Entity row;
+                row.fields["table"] = Value(DType::TEXT, table->name);
+                row.fields["column"] = Value(DType::TEXT, attr.name);
+                row.fields["rows"] = Value(DType::INT, cs.rowCount);
+                row.fields["null_frac"] = Value(DType::REAL, cs.nullFraction);
+                row.fields["distinct"] = Value(DType::INT, static_cast<int64_t>(std::llround(cs.distinct)));
+                row.fields["min"] = Value(attr.type, cs.min);
+                row.fields["max"] = Value(attr.type, cs.max);
+                rows.push_back(std::move(row));
+            }
+        }
+
+        return QueryResult::FromRows(std::move(rows), { "table", "column", "rows", "null_frac", "distinct", "min", "max" });
+    }
+
+    /* -------- STATS --------
+       STATS                        latency percentiles and work counters per command type
+       STATS RESET
+       STATS DUMP 'file' [seconds]  append a JSON snapshot to the file periodically (default 60 s)
+       STATS DUMP OFF
+    */
+    if (tokens[0] == "STATS")
+    {
+        QueryParser parser(query);
+        parser.ExpectKeyword("STATS");
+
+        if (parser.AcceptKeyword("RESET"))
+        {
+            parser.ExpectEnd();
+            GlobalQueryStats().Reset();
+            return {};
+        }
+
+        if (parser.AcceptKeyword("DUMP"))
+        {
+            if (parser.AcceptKeyword("OFF"))
+            {
+                parser.ExpectEnd();
+                GlobalStatsDumper().Stop();
+                return {};
+            }
+
+            const auto& pathTok = parser.Take();
+            if (pathTok.kind != QueryToken::Kind::String)
+                throw std::runtime_error("STATS DUMP requires a quoted file path or OFF");
+            std::string path = pathTok.text;
+
+            double seconds = 60.0;
+            if (!parser.AtEnd())
+            {
+                std::string interval = parser.ExpectWord();
+                char* end = nullptr;
+                seconds = std::strtod(interval.c_str(), &end);
+                if (*end != '\0' || !(seconds > 0.0))
+                    throw std::runtime_error("Invalid STATS DUMP interval: " + interval);
+            }
+            parser.ExpectEnd();
+
+            GlobalStatsDumper().Start(path, seconds);
+            return {};
+        }
+        parser.ExpectEnd();
+
+        std::vector<Entity> rows;
+        for (const auto& s : GlobalQueryStats().Summaries())
+        {
+            Entity row;
+            row.fields["command"] = Value(DType::TEXT, s.command);
+            row.fields["count"] = Value(DType::INT, s.count);
+            row.fields["errors"] = Value(DType::INT, s.errors);
+            row.fields["mean_ms"] = Value(DType::REAL, s.meanMs);
+            row.fields["p50_ms"] = Value(DType::REAL, s.p50Ms);
+            row.fields["p99_ms"] = Value(DType::REAL, s.p99Ms);
+            row.fields["p999_ms"] = Value(DType::REAL, s.p999Ms);
+            row.fields["max_ms"] = Value(DType::REAL, s.maxMs);
+            row.fields["rows_scanned"] = Value(DType::INT, s.rowsScanned);
+            row.fields["rows_returned"] = Value(DType::INT, s.rowsReturned);
+            row.fields["index_hits"] = Value(DType::INT, s.indexHits);
+            row.fields["cache_hits"] = Value(DType::INT, s.cacheHits);
+            row.fields["cache_misses"] = Value(DType::INT, s.cacheMisses);
+            rows.push_back(std::move(row));
+        }
+        return QueryResult::FromRows(std::move(rows), {
+            "command", "count", "errors", "mean_ms", "p50_ms", "p99_ms", "p999_ms", "max_ms",
+            "rows_scanned", "rows_returned", "index_hits", "cache_hits", "cache_misses" });
+    }
+
+    /* -------- TRACE --------
+       TRACE 'file'   write the spans recorded so far as Chrome trace-event JSON
+       TRACE RESET    discard recorded spans
+       Only available in builds configured with -DENABLE_TRACING=ON.
+    */
+    if (tokens[0] == "TRACE")
+    {
+        if (!kTracingEnabled)
+            throw std::runtime_error("Tracing is not compiled in; rebuild with -DENABLE_TRACING=ON");
+
+        QueryParser parser(query);
+        parser.ExpectKeyword("TRACE");
+        if (parser.AcceptKeyword("RESET"))
+        {
+            parser.ExpectEnd();
+            ResetTrace();
+            return {};
+        }
+
+        const auto& pathTok = parser.Take();
+        if (pathTok.kind != QueryToken::Kind::String)
+            throw std::runtime_error("TRACE requires a quoted file path or RESET");
+        std::string path = pathTok.text;
+        parser.ExpectEnd();
+
+        std::ofstream out(path, std::ios::binary);
+        if (!out)
+            throw std::runtime_error("Cannot write trace file: " + path);
+        return QueryResult::Affected(WriteChromeTrace(out));
+    }
+
+    /* -------- CAPTURE --------
+       CAPTURE 'file'   save a snapshot to file.db.json, then record every statement to file
+       CAPTURE OFF
+       CAPTURE          show the current setting
+    */
+    if (tokens[0] == "CAPTURE")
+    {
+        QueryParser parser(query);
+        parser.ExpectKeyword("CAPTURE");
+        auto& capture = GlobalWorkloadCapture();
+
+        if (parser.AtEnd())
+        {
+            Entity row;
+            row.fields["enabled"] = Value(DType::INT, capture.Enabled() ? 1 : 0);
+            row.fields["file"] = Value(DType::TEXT, capture.Enabled() ? capture.Path() : "");
+            row.fields["statements"] = Value(DType::INT, capture.Captured());
+            return QueryResult::FromRows({ row }, { "enabled", "file", "statements" });
+        }
+
+        if (parser.AcceptKeyword("OFF"))
+        {
+            parser.ExpectEnd();
+            capture.Stop();
+            return {};
+        }
+
+        const auto& pathTok = parser.Take();
+        if (pathTok.kind != QueryToken::Kind::String)
+            throw std::runtime_error("CAPTURE requires a quoted file path or OFF");
+        std::string path = pathTok.text;
+        parser.ExpectEnd();
+
+        // the replay starts from exactly the state the first captured statement saw
+        SaveToFile(db, WorkloadSnapshotPath(path));
+        capture.Start(path);
+        return {};
+    }
+
+    /* -------- SLOWLOG --------
+       SLOWLOG 'file' [threshold_ms]   log statements slower than the threshold (default 100 ms)
+       SLOWLOG OFF
+       SLOWLOG                         show the current setting
+    */
+    if (tokens[0] == "SLOWLOG")
+    {
+        QueryParser parser(query);
+        parser.ExpectKeyword("SLOWLOG");
+        auto& log = GlobalSlowQueryLog();
+
+        if (parser.AtEnd())
+        {
+            Entity row;
+            row.fields["enabled"] = Value(DType::INT, log.Enabled() ? 1 : 0);
+            row.fields["file"] = Value(DType::TEXT, log.Enabled() ? log.Path() : "");
+            row.fields["threshold_ms"] = Value(DType::REAL, static_cast<double>(log.ThresholdNanos()) / 1e6);
+            return QueryResult::FromRows({ row }, { "enabled", "file", "threshold_ms" });
+        }
+
+        if (parser.AcceptKeyword("OFF"))
+        {
+            parser.ExpectEnd();
+            log.Stop();
+            return {};
+        }
+
+        const auto& pathTok = parser.Take();
+        if (pathTok.kind != QueryToken::Kind::String)
+            throw std::runtime_error("SLOWLOG requires a quoted file path or OFF");
+        std::string path = pathTok.text;
+
+        double thresholdMs = 100.0;
+        if (!parser.AtEnd())
+        {
+            std::string value = parser.ExpectWord();
+            char* end = nullptr;
+            thresholdMs = std::strtod(value.c_str(), &end);
+            if (*end != '\0' || !(thresholdMs >= 0.0))
+                throw std::runtime_error("Invalid SLOWLOG threshold: " + value);
+        }
+        parser.ExpectEnd();
+
+        log.Start(path, thresholdMs);
+        return {};
+    }
+
+    /* -------- CACHE --------
+       CACHE ON [max_mb]   cache SELECT results, up to max_mb (default 64) of them
+       CACHE OFF           stop caching and drop cached results
+       CACHE CLEAR         drop cached results
+       CACHE               show the cache's state
+    */
+    if (tokens[0] == "CACHE")
+    {
+        QueryParser parser(query);
+        parser.ExpectKeyword("CACHE");
+        auto& cache = GlobalResultCache();
+
+        if (parser.AtEnd())
+        {
+            auto usage = cache.Stats();
+            CommandSummary select;
+            for (auto& s : GlobalQueryStats().Summaries())
+                if (s.command == CommandKindName(CommandKind::Select)) select = std::move(s);
+            Entity row;
+            row.fields["enabled"] = Value(DType::INT, cache.Enabled() ? 1 : 0);
+            row.fields["entries"] = Value(DType::INT, usage.entries);
+            row.fields["bytes"] = Value(DType::INT, usage.bytes);
+            row.fields["capacity"] = Value(DType::INT, usage.capacity);
+            row.fields["hits"] = Value(DType::INT, select.cacheHits);
+            row.fields["misses"] = Value(DType::INT, select.cacheMisses);
+            row.fields["evictions"] = Value(DType::INT, usage.evictions);
+            row.fields["invalidations"] = Value(DType::INT, usage.invalidations);
+            return QueryResult::FromRows({ row }, { "enabled", "entries", "bytes", "capacity", "hits", "misses",
+                "evictions", "invalidations" });
+        }
+
+        if (parser.AcceptKeyword("OFF"))
+        {
+            parser.ExpectEnd();
+            cache.Disable();
+            return {};
+        }
+
+        if (parser.AcceptKeyword("CLEAR"))
+        {
+            parser.ExpectEnd();
+            cache.Clear();
+            return {};
+        }
+
+        parser.ExpectKeyword("ON");
+        double maxMb = static_cast<double>(ResultCache::kDefaultCapacity >> 20);
+        if (!parser.AtEnd())
+        {
+            std::string value = parser.ExpectWord();
+            char* end = nullptr;
+            maxMb = std::strtod(value.c_str(), &end);
+            if (*end != '\0' || !(maxMb > 0.0))
+                throw std::runtime_error("Invalid CACHE size: " + value);
+        }
+        parser.ExpectEnd();
+
+        cache.Enable(static_cast<size_t>(maxMb * 1024.0 * 1024.0));
+        return {};
+    }
+
+    throw std::runtime_error("Unknown command: " + tokens[0]);
+}
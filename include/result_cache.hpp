@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <database.hpp>
+
+/* =======================
+   RESULT CACHE
+   ======================= */
+
+// A finished SELECT result and the version of every table it read. It is only served
+// while each of those tables still has that version; any Insert, UPDATE, REMOVE or
+// compaction gives the table a new one (Table::Touch).
+struct CachedResult
+{
+    std::vector<std::string> columns;
+    std::vector<Entity> rows;
+    std::vector<std::pair<std::string, uint64_t>> tables;  // name, version
+    size_t bytes = 0;
+};
+
+// Rough heap footprint of a result row, for the cache's memory cap
+inline size_t EstimateEntityBytes(const Entity& e)
+{
+    constexpr size_t kNodeBytes = sizeof(void*) + sizeof(size_t) + sizeof(std::string) + sizeof(Value);
+    size_t bytes = sizeof(Entity) + e.fields.bucket_count() * sizeof(void*) + e.fields.size() * kNodeBytes;
+    for (const auto& [name, v] : e.fields)
+    {
+        if (name.capacity() > 15) bytes += name.capacity() + 1;
+        if (v.data.is_string()) bytes += sizeof(std::string) + v.data.get_ref<const std::string&>().capacity() + 1;
+        else if (v.data.is_structured()) bytes += v.data.dump().size() * 2;
+    }
+    return bytes;
+}
+
+// Opt-in LRU cache of SELECT results keyed by normalized query text. Stale entries are
+// dropped when looked up; the least recently used ones go when the byte cap is reached.
+// Safe to use from several threads.
+class ResultCache
+{
+public:
+    static constexpr size_t kDefaultCapacity = size_t(64) << 20;
+
+    struct Usage
+    {
+        size_t entries = 0;
+        size_t bytes = 0;
+        size_t capacity = 0;
+        uint64_t evictions = 0;      // dropped to stay under the cap
+        uint64_t invalidations = 0;  // dropped because a table changed
+    };
+
+    void Enable(size_t capacityBytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        capacity = capacityBytes;
+        Shrink(capacity);
+        enabled.store(true, std::memory_order_release);
+    }
+
+    void Disable()
+    {
+        enabled.store(false, std::memory_order_release);
+        Clear();
+    }
+
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        lru.clear();
+        index.clear();
+        usage.bytes = 0;
+    }
+
+    bool Enabled() const { return enabled.load(std::memory_order_acquire); }
+
+    // Results larger than this are not worth evicting everything else for
+    size_t MaxEntryBytes() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return capacity / 4;
+    }
+
+    std::shared_ptr<const CachedResult> Lookup(const Database& db, const std::string& key)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(key);
+        if (it == index.end()) return nullptr;
+
+        const auto& result = it->second->second;
+        for (const auto& [name, version] : result->tables)
+        {
+            auto t = db.GetTables().find(name);
+            if (t == db.GetTables().end() || t->second->version != version)
+            {
+                ++usage.invalidations;
+                Erase(it->second);
+                return nullptr;
+            }
+        }
+        lru.splice(lru.begin(), lru, it->second);
+        return result;
+    }
+
+    void Insert(const std::string& key, std::shared_ptr<const CachedResult> result)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!Enabled() || result->bytes > capacity / 4) return;
+
+        auto it = index.find(key);
+        if (it != index.end()) Erase(it->second);
+
+        Shrink(capacity - result->bytes);
+        usage.bytes += result->bytes;
+        lru.emplace_front(key, std::move(result));
+        index[key] = lru.begin();
+    }
+
+    Usage Stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Usage u = usage;
+        u.entries = lru.size();
+        u.capacity = capacity;
+        return u;
+    }
+
+private:
+    using Entry = std::pair<std::string, std::shared_ptr<const CachedResult>>;
+
+    void Erase(std::list<Entry>::iterator it)
+    {
+        usage.bytes -= it->second->bytes;
+        index.erase(it->first);
+        lru.erase(it);
+    }
+
+    // Evicts from the cold end until at most `limit` bytes remain
+    void Shrink(size_t limit)
+    {
+        while (!lru.empty() && usage.bytes > limit)
+        {
+            Erase(std::prev(lru.end()));
+            ++usage.evictions;
+        }
+    }
+
+    std::atomic<bool> enabled{ false };
+    mutable std::mutex mutex;
+    size_t capacity = kDefaultCapacity;
+    std::list<Entry> lru;  // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    Usage usage;
+};
+
+inline ResultCache& GlobalResultCache()
+{
+    static ResultCache cache;
+    return cache;
+}
@@ -0,0 +1,363 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <database.hpp>
+
+/* =======================
+   RESULT FORMATS
+   ======================= */
+
+enum class OutputFormat
+{
+    Table,      // aligned columns with a header, for people
+    Csv,        // RFC 4180: header line, fields quoted when needed
+    JsonLines,  // one JSON object per row
+    Tsv         // header line, tab separated, \t \n \r \\ escaped
+};
+
+inline const char* OutputFormatName(OutputFormat f)
+{
+    switch (f)
+    {
+    case OutputFormat::Table: return "table";
+    case OutputFormat::Csv: return "csv";
+    case OutputFormat::JsonLines: return "jsonl";
+    case OutputFormat::Tsv: return "tsv";
+    }
+    return "table";
+}
+
+inline OutputFormat ParseOutputFormat(std::string name)
+{
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+    if (name == "table") return OutputFormat::Table;
+    if (name == "csv") return OutputFormat::Csv;
+    if (name == "jsonl" || name == "json") return OutputFormat::JsonLines;
+    if (name == "tsv") return OutputFormat::Tsv;
+    throw std::runtime_error("Unknown output format: " + name + " (table, csv, jsonl, tsv)");
+}
+
+/* =======================
+   RESULT WRITER
+   ======================= */
+
+// Formats result rows into one large buffer that goes to the stream in big writes, so
+// printing millions of rows costs a few appends per field instead of a stream call per
+// token. Numbers are formatted with std::to_chars and strings are escaped by hand.
+//
+//   ResultWriter w(std::cout, OutputFormat::Csv);
+//   w.Begin(columns);          // header; empty = the first row's field order
+//   w.Rows(batch);             // any number of batches
+//   w.End();                   // row count footer (table format) and final flush
+class ResultWriter
+{
+public:
+    static constexpr size_t kBufferBytes = 1 << 20;
+
+    ResultWriter(std::ostream& out, OutputFormat format) : out(out), format(format)
+    {
+        buf.reserve(kBufferBytes + 4096);
+    }
+
+    ~ResultWriter() { Flush(); }
+
+    ResultWriter(const ResultWriter&) = delete;
+    ResultWriter& operator=(const ResultWriter&) = delete;
+
+    void Begin(std::vector<std::string> cols)
+    {
+        columns = std::move(cols);
+        started = !columns.empty();
+        if (started && format != OutputFormat::Table) Header();
+    }
+
+    void Rows(std::span<const Entity> rows)
+    {
+        if (rows.empty()) return;
+        if (!started)
+        {
+            for (const auto& [name, v] : rows.front().fields)
+                columns.push_back(name);
+            started = true;
+            if (format != OutputFormat::Table) Header();
+        }
+        if (format == OutputFormat::Table && widths.empty()) SizeColumns(rows);
+
+        for (const auto& row : rows)
+        {
+            switch (format)
+            {
+            case OutputFormat::Table: TableRow(row); break;
+            case OutputFormat::Csv: SeparatedRow(row, ','); break;
+            case OutputFormat::Tsv: SeparatedRow(row, '\t'); break;
+            case OutputFormat::JsonLines: JsonRow(row); break;
+            }
+            if (buf.size() >= kBufferBytes) Flush();
+        }
+        count += rows.size();
+    }
+
+    void End()
+    {
+        if (format == OutputFormat::Table)
+        {
+            if (count == 0) buf += "(no rows)\n";
+            else
+            {
+                AppendUnsigned(count);
+                buf += count == 1 ? " row\n" : " rows\n";
+            }
+        }
+        Flush();
+        out.flush();
+    }
+
+    void Flush()
+    {
+        if (buf.empty()) return;
+        out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+        buf.clear();
+    }
+
+    size_t RowCount() const { return count; }
+
+private:
+    std::ostream& out;
+    OutputFormat format;
+    std::string buf;
+    std::vector<std::string> columns;
+    std::vector<size_t> widths;  // table format, fixed from the first batch
+    std::vector<bool> numeric;   // table format: right-align
+    std::string scratch;
+    bool started = false;
+    size_t count = 0;
+
+    const json* Field(const Entity& row, size_t c) const
+    {
+        auto it = row.fields.find(columns[c]);
+        return it == row.fields.end() ? nullptr : &it->second.data;
+    }
+
+    /* ---------- scalars ---------- */
+
+    void AppendUnsigned(uint64_t v)
+    {
+        char tmp[24];
+        auto r = std::to_chars(tmp, tmp + sizeof(tmp), v);
+        buf.append(tmp, r.ptr);
+    }
+
+    // Text form of a value: numbers via to_chars (shortest round-trip for doubles), strings
+    // as they are, RELATION values as compact JSON. Null is empty.
+    void AppendPlain(std::string& dst, const json& v)
+    {
+        char tmp[32];
+        switch (v.type())
+        {
+        case json::value_t::number_integer:
+            dst.append(tmp, std::to_chars(tmp, tmp + sizeof(tmp), v.get_ref<const json::number_integer_t&>()).ptr);
+            break;
+        case json::value_t::number_unsigned:
+            dst.append(tmp, std::to_chars(tmp, tmp + sizeof(tmp), v.get_ref<const json::number_unsigned_t&>()).ptr);
+            break;
+        case json::value_t::number_float:
+            dst.append(tmp, std::to_chars(tmp, tmp + sizeof(tmp), v.get_ref<const json::number_float_t&>()).ptr);
+            break;
+        case json::value_t::string: dst += v.get_ref<const std::string&>(); break;
+        case json::value_t::boolean: dst += v.get<bool>() ? "true" : "false"; break;
+        case json::value_t::null: break;
+        default: dst += v.dump(); break;
+        }
+    }
+
+    void AppendJsonString(std::string_view s)
+    {
+        static constexpr char kHex[] = "0123456789abcdef";
+        buf += '"';
+        size_t run = 0;
+        for (size_t i = 0; i < s.size(); ++i)
+        {
+            unsigned char c = static_cast<unsigned char>(s[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+            buf.append(s.data() + run, i - run);
+            run = i + 1;
+            switch (c)
+            {
+            case '"': buf += "\\\""; break;
+            case '\\': buf += "\\\\"; break;
+            case '\n': buf += "\\n"; break;
+            case '\r': buf += "\\r"; break;
+            case '\t': buf += "\\t"; break;
+            default:
+                buf += "\\u00";
+                buf += kHex[c >> 4];
+                buf += kHex[c & 15];
+            }
+        }
+        buf.append(s.data() + run, s.size() - run);
+        buf += '"';
+    }
+
+    /* ---------- formats ---------- */
+
+    void Header()
+    {
+        if (format == OutputFormat::JsonLines) return;
+        char sep = format == OutputFormat::Csv ? ',' : '\t';
+        for (size_t c = 0; c < columns.size(); ++c)
+        {
+            if (c) buf += sep;
+            AppendSeparated(columns[c], sep);
+        }
+        buf += '\n';
+    }
+
+    void AppendSeparated(std::string_view s, char sep)
+    {
+        if (sep == ',')
+        {
+            if (s.find_first_of(",\"\n\r") == std::string_view::npos)
+            {
+                buf += s;
+                return;
+            }
+            buf += '"';
+            for (char ch : s)
+            {
+                if (ch == '"') buf += '"';
+                buf += ch;
+            }
+            buf += '"';
+            return;
+        }
+
+        if (s.find_first_of("\t\n\r\\") == std::string_view::npos)
+        {
+            buf += s;
+            return;
+        }
+        for (char ch : s)
+        {
+            switch (ch)
+            {
+            case '\t': buf += "\\t"; break;
+            case '\n': buf += "\\n"; break;
+            case '\r': buf += "\\r"; break;
+            case '\\': buf += "\\\\"; break;
+            default: buf += ch;
+            }
+        }
+    }
+
+    void SeparatedRow(const Entity& row, char sep)
+    {
+        for (size_t c = 0; c < columns.size(); ++c)
+        {
+            if (c) buf += sep;
+            const json* v = Field(row, c);
+            if (!v) continue;
+            if (v->is_string())
+            {
+                AppendSeparated(v->get_ref<const std::string&>(), sep);
+                continue;
+            }
+            if (!v->is_structured())
+            {
+                AppendPlain(buf, *v);
+                continue;
+            }
+            scratch.clear();
+            AppendPlain(scratch, *v);
+            AppendSeparated(scratch, sep);
+        }
+        buf += '\n';
+    }
+
+    void JsonRow(const Entity& row)
+    {
+        buf += '{';
+        for (size_t c = 0; c < columns.size(); ++c)
+        {
+            if (c) buf += ',';
+            AppendJsonString(columns[c]);
+            buf += ':';
+            const json* v = Field(row, c);
+            // JSON has no inf/nan; write null as nlohmann does when saving
+            if (!v || v->is_null() || (v->is_number_float() && !std::isfinite(v->get<double>()))) buf += "null";
+            else if (v->is_string()) AppendJsonString(v->get_ref<const std::string&>());
+            else AppendPlain(buf, *v);
+        }
+        buf += "}\n";
+    }
+
+    // Column widths come from the header and the first batch; later values that are
+    // wider are printed in full and push the rest of their line right
+    void SizeColumns(std::span<const Entity> rows)
+    {
+        widths.assign(columns.size(), 0);
+        numeric.assign(columns.size(), true);
+        for (size_t c = 0; c < columns.size(); ++c)
+        {
+            widths[c] = columns[c].size();
+            bool any = false;
+            for (const auto& row : rows)
+            {
+                const json* v = Field(row, c);
+                if (!v || v->is_null()) continue;
+                any = true;
+                if (!v->is_number()) numeric[c] = false;
+                scratch.clear();
+                AppendPlain(scratch, *v);
+                widths[c] = std::max(widths[c], scratch.size());
+            }
+            numeric[c] = numeric[c] && any;
+        }
+
+        for (size_t c = 0; c < columns.size(); ++c)
+        {
+            if (c) buf += " | ";
+            Pad(columns[c], widths[c], false, c + 1 == columns.size());
+        }
+        buf += '\n';
+        for (size_t c = 0; c < columns.size(); ++c)
+        {
+            if (c) buf += "-+-";
+            buf.append(widths[c], '-');
+        }
+        buf += '\n';
+    }
+
+    void Pad(std::string_view s, size_t width, bool right, bool last)
+    {
+        size_t fill = width > s.size() ? width - s.size() : 0;
+        if (right) buf.append(fill, ' ');
+        buf += s;
+        if (!right && !last) buf.append(fill, ' ');
+    }
+
+    void TableRow(const Entity& row)
+    {
+        for (size_t c = 0; c < columns.size(); ++c)
+        {
+            if (c) buf += " | ";
+            const json* v = Field(row, c);
+            scratch.clear();
+            if (!v || v->is_null()) scratch = "NULL";
+            else AppendPlain(scratch, *v);
+            Pad(scratch, widths[c], numeric[c], c + 1 == columns.size());
+        }
+        buf += '\n';
+    }
+};
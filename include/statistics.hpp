@@ -0,0 +1,253 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+/* =======================
+   HYPERLOGLOG
+   ======================= */
+
+// Distinct-count sketch: 2^12 one-byte registers (~1.6% standard error)
+class HyperLogLog
+{
+public:
+    static constexpr int kPrecision = 12;
+    static constexpr size_t kRegisters = size_t(1) << kPrecision;
+
+    HyperLogLog() : registers(kRegisters, 0) {}
+
+    void Add(uint64_t hash)
+    {
+        size_t idx = hash >> (64 - kPrecision);
+        uint64_t rest = (hash << kPrecision) | (uint64_t(1) << (kPrecision - 1));
+        uint8_t rank = static_cast<uint8_t>(std::countl_zero(rest) + 1);
+        if (rank > registers[idx]) registers[idx] = rank;
+    }
+
+    double Estimate() const
+    {
+        const double m = static_cast<double>(kRegisters);
+        double sum = 0.0;
+        size_t zeros = 0;
+        for (uint8_t r : registers)
+        {
+            sum += std::ldexp(1.0, -r);
+            if (r == 0) ++zeros;
+        }
+
+        double alpha = 0.7213 / (1.0 + 1.079 / m);
+        double e = alpha * m * m / sum;
+
+        // small range correction (linear counting)
+        if (e <= 2.5 * m && zeros != 0)
+            e = m * std::log(m / static_cast<double>(zeros));
+
+        return e;
+    }
+
+    // Mixes std::hash<json> output so the high bits used for bucketing are well spread
+    static uint64_t HashValue(const json& v)
+    {
+        uint64_t x = static_cast<uint64_t>(std::hash<json>{}(v));
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+private:
+    std::vector<uint8_t> registers;
+};
+
+/* =======================
+   COLUMN STATISTICS
+   ======================= */
+
+struct ColumnStats
+{
+    uint64_t rowCount = 0;
+    uint64_t nullCount = 0;
+    double nullFraction = 0.0;
+    double distinct = 0.0;          // HyperLogLog estimate over all non-null values
+    json min;
+    json max;
+
+    // Equi-depth histogram: bounds[i]..bounds[i+1] hold roughly the same number of rows
+    std::vector<json> histogramBounds;
+
+    // Most common values with their frequency (fraction of all rows)
+    std::vector<std::pair<json, double>> mostCommon;
+};
+
+struct TableStats
+{
+    bool analyzed = false;
+    uint64_t rowCount = 0;
+    std::unordered_map<std::string, ColumnStats> columns;
+};
+
+constexpr size_t kStatsSampleSize = 30000;
+constexpr size_t kHistogramBuckets = 32;
+constexpr size_t kMostCommonValues = 10;
+
+// Builds histogram and most-common-values from a (sampled) set of non-null values.
+// `sampledRows` is the number of rows the sample represents, including nulls.
+inline void BuildDistribution(ColumnStats& stats, std::vector<json> sample, size_t sampledRows)
+{
+    stats.histogramBounds.clear();
+    stats.mostCommon.clear();
+    if (sample.empty() || sampledRows == 0) return;
+
+    std::sort(sample.begin(), sample.end());
+
+    // run-length count of equal values -> most common values
+    std::vector<std::pair<json, size_t>> runs;
+    for (size_t i = 0; i < sample.size();)
+    {
+        size_t j = i + 1;
+        while (j < sample.size() && sample[j] == sample[i]) ++j;
+        runs.emplace_back(sample[i], j - i);
+        i = j;
+    }
+
+    std::stable_sort(runs.begin(), runs.end(),
+        [](const auto& a, const auto& b) { return a.second > b.second; });
+
+    for (size_t i = 0; i < runs.size() && i < kMostCommonValues; ++i)
+    {
+        // a value seen once in the sample is not "common"
+        if (runs[i].second < 2) break;
+        stats.mostCommon.emplace_back(runs[i].first,
+            static_cast<double>(runs[i].second) / static_cast<double>(sampledRows));
+    }
+
+    size_t buckets = std::min(kHistogramBuckets, sample.size());
+    for (size_t b = 0; b <= buckets; ++b)
+    {
+        size_t idx = std::min(sample.size() - 1, b * (sample.size() - 1) / buckets);
+        stats.histogramBounds.push_back(sample[idx]);
+    }
+}
+
+/* =======================
+   SELECTIVITY ESTIMATION
+   ======================= */
+
+// Estimated fraction of rows with column == value
+inline double EstimateEqualsSelectivity(const ColumnStats& stats, const json& value)
+{
+    if (stats.rowCount == 0) return 0.0;
+    if (value.is_null()) return stats.nullFraction;
+
+    double mcvTotal = 0.0;
+    for (const auto& [v, freq] : stats.mostCommon)
+    {
+        if (v == value) return freq;
+        mcvTotal += freq;
+    }
+
+    if (!stats.min.is_null() && (value < stats.min || stats.max < value))
+        return 0.0;
+
+    double remainingDistinct = stats.distinct - static_cast<double>(stats.mostCommon.size());
+    if (remainingDistinct < 1.0) remainingDistinct = 1.0;
+    double remaining = 1.0 - stats.nullFraction - mcvTotal;
+    if (remaining < 0.0) remaining = 0.0;
+    return remaining / remainingDistinct;
+}
+
+// Estimated fraction of non-null rows with column < value (or <= when inclusive)
+inline double EstimateLessThanSelectivity(const ColumnStats& stats, const json& value, bool inclusive)
+{
+    const auto& bounds = stats.histogramBounds;
+    if (stats.rowCount == 0 || bounds.size() < 2) return 1.0 / 3.0;
+
+    double nonNull = 1.0 - stats.nullFraction;
+    if (value < bounds.front()) return 0.0;
+    if (bounds.back() < value || (inclusive && bounds.back() == value)) return nonNull;
+
+    size_t buckets = bounds.size() - 1;
+    size_t b = 0;
+    while (b + 1 < buckets && !(value < bounds[b + 1])) ++b;
+
+    // linear interpolation inside the bucket for numbers, half a bucket otherwise
+    double within = 0.5;
+    if (value.is_number() && bounds[b].is_number() && bounds[b + 1].is_number())
+    {
+        double lo = bounds[b].get<double>();
+        double hi = bounds[b + 1].get<double>();
+        double v = value.get<double>();
+        within = hi > lo ? (v - lo) / (hi - lo) : 0.5;
+        within = std::clamp(within, 0.0, 1.0);
+    }
+
+    return nonNull * (static_cast<double>(b) + within) / static_cast<double>(buckets);
+}
+
+/* =======================
+   PERSISTENCE
+   ======================= */
+
+inline json StatsToJson(const TableStats& stats)
+{
+    json j;
+    j["rows"] = stats.rowCount;
+
+    for (const auto& [col, cs] : stats.columns)
+    {
+        json jc = {
+            {"rows", cs.rowCount},
+            {"nulls", cs.nullCount},
+            {"null_frac", cs.nullFraction},
+            {"distinct", cs.distinct},
+            {"min", cs.min},
+            {"max", cs.max},
+            {"histogram", cs.histogramBounds}
+        };
+        jc["mcv"] = json::array();
+        for (const auto& [v, freq] : cs.mostCommon)
+            jc["mcv"].push_back({{"value", v}, {"freq", freq}});
+        j["columns"][col] = jc;
+    }
+
+    return j;
+}
+
+inline TableStats StatsFromJson(const json& j)
+{
+    TableStats stats;
+    stats.analyzed = true;
+    stats.rowCount = j.value("rows", uint64_t(0));
+
+    if (!j.contains("columns")) return stats;
+
+    for (const auto& [col, jc] : j["columns"].items())
+    {
+        ColumnStats cs;
+        cs.rowCount = jc.value("rows", uint64_t(0));
+        cs.nullCount = jc.value("nulls", uint64_t(0));
+        cs.nullFraction = jc.value("null_frac", 0.0);
+        cs.distinct = jc.value("distinct", 0.0);
+        if (jc.contains("min")) cs.min = jc["min"];
+        if (jc.contains("max")) cs.max = jc["max"];
+        if (jc.contains("histogram"))
+            cs.histogramBounds = jc["histogram"].get<std::vector<json>>();
+        if (jc.contains("mcv"))
+        {
+            for (const auto& m : jc["mcv"])
+                cs.mostCommon.emplace_back(m["value"], m["freq"].get<double>());
+        }
+        stats.columns[col] = std::move(cs);
+    }
+
+    return stats;
+}
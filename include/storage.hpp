@@ -0,0 +1,1090 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_set>
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+#include <new>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+/* =======================
+   OS PAGES
+   ======================= */
+
+// Pages come straight from the OS (mmap / VirtualAlloc) so that releasing an arena
+// returns its memory to the OS instead of leaving it in the malloc heap
+inline void* AllocatePages(size_t bytes)
+{
+#ifdef _WIN32
+    void* p = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (!p) throw std::bad_alloc();
+#else
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) throw std::bad_alloc();
+#endif
+    return p;
+}
+
+inline void FreePages(void* p, size_t bytes)
+{
+#ifdef _WIN32
+    (void)bytes;
+    VirtualFree(p, 0, MEM_RELEASE);
+#else
+    munmap(p, bytes);
+#endif
+}
+
+/* =======================
+   ARENA
+   ======================= */
+
+constexpr size_t kArenaPageSize = 256 * 1024;
+constexpr size_t kOsPageSize = 4096;
+
+// Bump allocator over OS pages. Individual allocations are never freed; the whole
+// arena is released at once (compaction, DROP TABLE, table destruction).
+class Arena
+{
+public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    Arena(Arena&& other) noexcept { *this = std::move(other); }
+
+    Arena& operator=(Arena&& other) noexcept
+    {
+        if (this == &other) return *this;
+        Release();
+        pages = std::move(other.pages);
+        cur = other.cur;
+        remaining = other.remaining;
+        used = other.used;
+        reserved = other.reserved;
+        other.pages.clear();
+        other.cur = nullptr;
+        other.remaining = other.used = other.reserved = 0;
+        return *this;
+    }
+
+    ~Arena() { Release(); }
+
+    void* Allocate(size_t bytes, size_t align = alignof(std::max_align_t))
+    {
+        // big requests get their own pages so they don't strand the current page's tail
+        if (bytes > kArenaPageSize / 4)
+        {
+            size_t size = (bytes + kOsPageSize - 1) & ~(kOsPageSize - 1);
+            char* base = static_cast<char*>(AllocatePages(size));
+            pages.push_back({ base, size });
+            reserved += size;
+            used += bytes;
+            return base;
+        }
+
+        size_t pad = cur ? (align - reinterpret_cast<uintptr_t>(cur) % align) % align : 0;
+        if (!cur || pad + bytes > remaining)
+        {
+            char* base = static_cast<char*>(AllocatePages(kArenaPageSize));
+            pages.push_back({ base, kArenaPageSize });
+            reserved += kArenaPageSize;
+            cur = base;
+            remaining = kArenaPageSize;
+            pad = 0;
+        }
+
+        char* p = cur + pad;
+        cur += pad + bytes;
+        remaining -= pad + bytes;
+        used += bytes;
+        return p;
+    }
+
+    void Release()
+    {
+        for (const auto& pg : pages)
+            FreePages(pg.base, pg.size);
+        pages.clear();
+        cur = nullptr;
+        remaining = used = reserved = 0;
+    }
+
+    size_t ReservedBytes() const { return reserved; }
+    size_t UsedBytes() const { return used; }
+    size_t PageCount() const { return pages.size(); }
+
+private:
+    struct Page
+    {
+        char* base;
+        size_t size;
+    };
+
+    std::vector<Page> pages;
+    char* cur = nullptr;
+    size_t remaining = 0;
+    size_t used = 0;
+    size_t reserved = 0;
+};
+
+/* =======================
+   STRING POOL
+   ======================= */
+
+constexpr size_t kStringSizeClasses[] = { 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+constexpr uint32_t kNumStringClasses = sizeof(kStringSizeClasses) / sizeof(kStringSizeClasses[0]);
+constexpr uint32_t kEmptyStringClass = 0xfe;    // no storage at all
+constexpr uint32_t kOversizeStringClass = 0xff; // malloc'd individually
+
+struct StringSlot
+{
+    char* data = nullptr;
+    uint32_t size = 0;
+    uint32_t sizeClass = kEmptyStringClass;
+};
+
+// Slab allocator for variable-length text: slots of power-of-two size classes are
+// carved from an arena, and freed slots go on a per-class free list for reuse.
+// Strings longer than the largest class are allocated individually.
+class StringPool
+{
+public:
+    StringPool() = default;
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+    StringPool(StringPool&& other) noexcept { *this = std::move(other); }
+
+    StringPool& operator=(StringPool&& other) noexcept
+    {
+        if (this == &other) return *this;
+        Release();
+        arena = std::move(other.arena);
+        std::copy(std::begin(other.freeLists), std::end(other.freeLists), std::begin(freeLists));
+        std::fill(std::begin(other.freeLists), std::end(other.freeLists), nullptr);
+        oversize = std::move(other.oversize);
+        other.oversize.clear();
+        liveBytes = other.liveBytes;
+        freeBytes = other.freeBytes;
+        oversizeBytes = other.oversizeBytes;
+        payloadBytes = other.payloadBytes;
+        other.liveBytes = other.freeBytes = other.oversizeBytes = other.payloadBytes = 0;
+        return *this;
+    }
+
+    ~StringPool() { Release(); }
+
+    StringSlot Store(std::string_view s)
+    {
+        StringSlot slot;
+        slot.size = static_cast<uint32_t>(s.size());
+        if (s.empty()) return slot;
+
+        slot.sizeClass = ClassFor(s.size());
+        if (slot.sizeClass == kOversizeStringClass)
+        {
+            slot.data = static_cast<char*>(std::malloc(s.size()));
+            if (!slot.data) throw std::bad_alloc();
+            oversize.insert(slot.data);
+            oversizeBytes += s.size();
+        }
+        else
+        {
+            size_t bytes = kStringSizeClasses[slot.sizeClass];
+            if (FreeNode* node = freeLists[slot.sizeClass])
+            {
+                freeLists[slot.sizeClass] = node->next;
+                slot.data = reinterpret_cast<char*>(node);
+                freeBytes -= bytes;
+            }
+            else
+                slot.data = static_cast<char*>(arena.Allocate(bytes, alignof(FreeNode)));
+            liveBytes += bytes;
+            payloadBytes += s.size();
+        }
+
+        std::memcpy(slot.data, s.data(), s.size());
+        return slot;
+    }
+
+    void Free(StringSlot& slot)
+    {
+        if (slot.sizeClass == kOversizeStringClass)
+        {
+            oversize.erase(slot.data);
+            oversizeBytes -= slot.size;
+            std::free(slot.data);
+        }
+        else if (slot.sizeClass < kNumStringClasses)
+        {
+            auto* node = reinterpret_cast<FreeNode*>(slot.data);
+            node->next = freeLists[slot.sizeClass];
+            freeLists[slot.sizeClass] = node;
+            size_t bytes = kStringSizeClasses[slot.sizeClass];
+            liveBytes -= bytes;
+            freeBytes += bytes;
+            payloadBytes -= slot.size;
+        }
+        slot = StringSlot();
+    }
+
+    static std::string_view View(const StringSlot& slot)
+    {
+        return std::string_view(slot.data, slot.size);
+    }
+
+    void Release()
+    {
+        arena.Release();
+        for (void* p : oversize)
+            std::free(p);
+        oversize.clear();
+        std::fill(std::begin(freeLists), std::end(freeLists), nullptr);
+        liveBytes = freeBytes = oversizeBytes = payloadBytes = 0;
+    }
+
+    size_t ReservedBytes() const { return arena.ReservedBytes() + oversizeBytes; }
+    size_t PageCount() const { return arena.PageCount(); }
+    size_t LiveBytes() const { return liveBytes + oversizeBytes; }  // slot bytes in use
+    size_t FreeListBytes() const { return freeBytes; }
+    size_t PayloadBytes() const { return payloadBytes + oversizeBytes; }  // string bytes proper
+
+private:
+    struct FreeNode
+    {
+        FreeNode* next;
+    };
+
+    static uint32_t ClassFor(size_t size)
+    {
+        for (uint32_t c = 0; c < kNumStringClasses; ++c)
+            if (size <= kStringSizeClasses[c]) return c;
+        return kOversizeStringClass;
+    }
+
+    Arena arena;
+    FreeNode* freeLists[kNumStringClasses] = {};
+    std::unordered_set<void*> oversize;
+    size_t liveBytes = 0;
+    size_t freeBytes = 0;
+    size_t oversizeBytes = 0;
+    size_t payloadBytes = 0;  // in-class strings only, without size-class rounding
+};
+
+/* =======================
+   INTEGER COMPRESSION
+   ======================= */
+
+enum class IntEncoding : uint8_t
+{
+    Plain,             // raw int64 values
+    FrameOfReference,  // value - min, bit-packed
+    Delta,             // difference to the previous value - min difference, bit-packed
+    RunLength          // (value, end) pairs
+};
+
+inline const char* IntEncodingName(IntEncoding e)
+{
+    switch (e)
+    {
+    case IntEncoding::Plain: return "plain";
+    case IntEncoding::FrameOfReference: return "for";
+    case IntEncoding::Delta: return "delta";
+    case IntEncoding::RunLength: return "rle";
+    }
+    return "?";
+}
+
+// Delta blocks keep the full value of every 16th row so one value can be decoded
+// without summing the deltas of the whole block
+constexpr size_t kDeltaAnchorInterval = 16;
+
+// Header of an immutable encoded block of integers; the payload words follow it.
+//   Plain:            count raw values
+//   FrameOfReference: count (value - base) packed at `width` bits
+//   Delta:            one anchor value per kDeltaAnchorInterval rows, then count
+//                     (value[i] - value[i-1] - base) packed at `width` bits
+//   RunLength:        `runs` values, then `runs` uint32 exclusive end rows, two per word
+// Arithmetic is modulo 2^64 so any int64 range round-trips.
+struct PackedInts
+{
+    IntEncoding encoding = IntEncoding::Plain;
+    uint8_t width = 0;
+    uint16_t count = 0;
+    uint32_t runs = 0;
+    int64_t base = 0;
+
+    const uint64_t* Payload() const { return reinterpret_cast<const uint64_t*>(this + 1); }
+    uint64_t* Payload() { return reinterpret_cast<uint64_t*>(this + 1); }
+};
+
+static_assert(sizeof(PackedInts) == 2 * sizeof(uint64_t), "PackedInts header must be two words");
+
+inline size_t PackedWords(size_t count, unsigned width)
+{
+    return (count * width + 63) / 64;
+}
+
+inline uint64_t UnpackBitsAt(const uint64_t* words, size_t i, unsigned width)
+{
+    if (width == 0) return 0;
+    size_t bit = i * width;
+    size_t w = bit >> 6;
+    unsigned shift = bit & 63;
+    uint64_t v = words[w] >> shift;
+    if (shift + width > 64) v |= words[w + 1] << (64 - shift);
+    return width == 64 ? v : v & ((uint64_t(1) << width) - 1);
+}
+
+inline void PackBits(const uint64_t* in, size_t n, unsigned width, uint64_t* out)
+{
+    std::memset(out, 0, PackedWords(n, width) * sizeof(uint64_t));
+    if (width == 0) return;
+    for (size_t i = 0; i < n; ++i)
+    {
+        size_t bit = i * width;
+        size_t w = bit >> 6;
+        unsigned shift = bit & 63;
+        out[w] |= in[i] << shift;
+        if (shift + width > 64) out[w + 1] |= in[i] >> (64 - shift);
+    }
+}
+
+// Unpacks 64 values at a time: 64 values of `width` bits span exactly `width` words,
+// so every group starts on a word boundary and the inner loop has a fixed trip count
+inline void UnpackBits(const uint64_t* words, size_t n, unsigned width, uint64_t* out)
+{
+    if (width == 0)
+    {
+        std::fill(out, out + n, uint64_t(0));
+        return;
+    }
+
+    size_t full = n & ~size_t(63);
+    for (size_t g = 0; g < full; g += 64)
+    {
+        const uint64_t* src = words + (g / 64) * width;
+        for (size_t i = 0; i < 64; ++i)
+            out[g + i] = UnpackBitsAt(src, i, width);
+    }
+    for (size_t i = full; i < n; ++i)
+        out[i] = UnpackBitsAt(words, i, width);
+}
+
+inline unsigned BitsNeeded(uint64_t maxValue)
+{
+    unsigned bits = 0;
+    while (maxValue)
+    {
+        ++bits;
+        maxValue >>= 1;
+    }
+    return bits;
+}
+
+// Encodes `n` (at most 65535) values with whichever encoding needs the fewest words.
+// Returns the header followed by the payload.
+inline std::vector<uint64_t> EncodeInts(const int64_t* v, size_t n)
+{
+    if (n > UINT16_MAX)
+        throw std::runtime_error("Too many values for one packed block");
+
+    std::vector<uint64_t> raw(n);
+    for (size_t i = 0; i < n; ++i)
+        raw[i] = static_cast<uint64_t>(v[i]);
+
+    // candidate parameters
+    int64_t minValue = n ? *std::min_element(v, v + n) : 0;
+    uint64_t forMax = 0;
+    int64_t minDelta = 0;
+    uint32_t runs = n ? 1 : 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        forMax = std::max(forMax, raw[i] - static_cast<uint64_t>(minValue));
+        if (i == 0) continue;
+        int64_t d = static_cast<int64_t>(raw[i] - raw[i - 1]);
+        if (i == 1 || d < minDelta) minDelta = d;
+        if (v[i] != v[i - 1]) ++runs;
+    }
+    uint64_t deltaMax = 0;
+    for (size_t i = 1; i < n; ++i)
+        deltaMax = std::max(deltaMax, raw[i] - raw[i - 1] - static_cast<uint64_t>(minDelta));
+
+    unsigned forWidth = BitsNeeded(forMax);
+    unsigned deltaWidth = BitsNeeded(deltaMax);
+    size_t anchors = (n + kDeltaAnchorInterval - 1) / kDeltaAnchorInterval;
+
+    PackedInts h;
+    h.count = static_cast<uint16_t>(n);
+    size_t best = n;
+    if (size_t words = PackedWords(n, forWidth); words < best)
+    {
+        best = words;
+        h.encoding = IntEncoding::FrameOfReference;
+    }
+    if (size_t words = anchors + PackedWords(n, deltaWidth); words < best)
+    {
+        best = words;
+        h.encoding = IntEncoding::Delta;
+    }
+    if (size_t words = runs + (runs + 1) / 2; words < best)
+    {
+        best = words;
+        h.encoding = IntEncoding::RunLength;
+    }
+
+    std::vector<uint64_t> out(2 + best, 0);
+    auto* header = reinterpret_cast<PackedInts*>(out.data());
+    uint64_t* payload = header->Payload();
+
+    switch (h.encoding)
+    {
+    case IntEncoding::Plain:
+        std::copy(raw.begin(), raw.end(), payload);
+        break;
+    case IntEncoding::FrameOfReference:
+        h.width = static_cast<uint8_t>(forWidth);
+        h.base = minValue;
+        for (auto& x : raw) x -= static_cast<uint64_t>(minValue);
+        PackBits(raw.data(), n, forWidth, payload);
+        break;
+    case IntEncoding::Delta:
+    {
+        h.width = static_cast<uint8_t>(deltaWidth);
+        h.base = minDelta;
+        for (size_t a = 0; a < anchors; ++a)
+            payload[a] = raw[a * kDeltaAnchorInterval];
+        std::vector<uint64_t> deltas(n, 0);
+        for (size_t i = 1; i < n; ++i)
+            deltas[i] = raw[i] - raw[i - 1] - static_cast<uint64_t>(minDelta);
+        PackBits(deltas.data(), n, deltaWidth, payload + anchors);
+        break;
+    }
+    case IntEncoding::RunLength:
+    {
+        h.runs = runs;
+        auto* ends = reinterpret_cast<uint32_t*>(payload + runs);
+        uint32_t r = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (i > 0 && v[i] != v[i - 1]) ++r;
+            payload[r] = raw[i];
+            ends[r] = static_cast<uint32_t>(i + 1);
+        }
+        break;
+    }
+    }
+
+    *header = h;
+    return out;
+}
+
+inline size_t PackedSizeBytes(const PackedInts* p)
+{
+    size_t words = 0;
+    switch (p->encoding)
+    {
+    case IntEncoding::Plain: words = p->count; break;
+    case IntEncoding::FrameOfReference: words = PackedWords(p->count, p->width); break;
+    case IntEncoding::Delta:
+        words = (p->count + kDeltaAnchorInterval - 1) / kDeltaAnchorInterval + PackedWords(p->count, p->width);
+        break;
+    case IntEncoding::RunLength: words = p->runs + (p->runs + 1) / 2; break;
+    }
+    return sizeof(PackedInts) + words * sizeof(uint64_t);
+}
+
+inline int64_t PackedIntAt(const PackedInts* p, size_t i)
+{
+    const uint64_t* payload = p->Payload();
+    uint64_t base = static_cast<uint64_t>(p->base);
+
+    switch (p->encoding)
+    {
+    case IntEncoding::Plain:
+        return static_cast<int64_t>(payload[i]);
+    case IntEncoding::FrameOfReference:
+        return static_cast<int64_t>(base + UnpackBitsAt(payload, i, p->width));
+    case IntEncoding::Delta:
+    {
+        size_t anchor = i / kDeltaAnchorInterval;
+        uint64_t v = payload[anchor];
+        size_t first = anchor * kDeltaAnchorInterval;
+        if (p->width == 0) return static_cast<int64_t>(v + (i - first) * base);
+
+        const uint64_t* deltas = payload + (p->count + kDeltaAnchorInterval - 1) / kDeltaAnchorInterval;
+        for (size_t j = first + 1; j <= i; ++j)
+            v += UnpackBitsAt(deltas, j, p->width) + base;
+        return static_cast<int64_t>(v);
+    }
+    case IntEncoding::RunLength:
+    {
+        const auto* ends = reinterpret_cast<const uint32_t*>(payload + p->runs);
+        size_t r = std::upper_bound(ends, ends + p->runs, static_cast<uint32_t>(i)) - ends;
+        return static_cast<int64_t>(payload[r]);
+    }
+    }
+    return 0;
+}
+
+// Decodes the whole block into `out` (p->count values)
+inline void DecodeInts(const PackedInts* p, int64_t* out)
+{
+    const uint64_t* payload = p->Payload();
+    uint64_t base = static_cast<uint64_t>(p->base);
+    auto* u = reinterpret_cast<uint64_t*>(out);
+    size_t n = p->count;
+
+    switch (p->encoding)
+    {
+    case IntEncoding::Plain:
+        std::copy(payload, payload + n, u);
+        break;
+    case IntEncoding::FrameOfReference:
+        UnpackBits(payload, n, p->width, u);
+        for (size_t i = 0; i < n; ++i) u[i] += base;
+        break;
+    case IntEncoding::Delta:
+    {
+        size_t anchors = (n + kDeltaAnchorInterval - 1) / kDeltaAnchorInterval;
+        UnpackBits(payload + anchors, n, p->width, u);
+        uint64_t v = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            v = (i % kDeltaAnchorInterval == 0) ? payload[i / kDeltaAnchorInterval] : v + u[i] + base;
+            u[i] = v;
+        }
+        break;
+    }
+    case IntEncoding::RunLength:
+    {
+        const auto* ends = reinterpret_cast<const uint32_t*>(payload + p->runs);
+        size_t i = 0;
+        for (uint32_t r = 0; r < p->runs; ++r)
+            for (; i < ends[r]; ++i) u[i] = payload[r];
+        break;
+    }
+    }
+}
+
+/* =======================
+   COLUMN STORAGE
+   ======================= */
+
+// Rows are stored column by column in fixed-size row groups
+constexpr size_t kRowGroupSize = 1024;
+constexpr size_t kNullWords = kRowGroupSize / 64;
+
+// A dictionary-encoded text column falls back to plain strings past this many distinct values
+constexpr size_t kDictionaryMaxEntries = 4096;
+
+enum class StorageKind
+{
+    Int64,
+    Double,
+    String,
+    Json  // arbitrary JSON (RELATION columns), kept as json objects
+};
+
+// Summary of one column over one row group, used by scans to skip groups a filter cannot
+// match. min/max cover INT and FLOAT/REAL values only and are only ever widened: values
+// overwritten by UPDATE or tombstoned by REMOVE keep them conservative until compaction.
+struct ZoneMap
+{
+    uint32_t nullCount = 0;
+    bool hasValues = false;  // at least one non-null INT/FLOAT/REAL value was written
+    int64_t minInt = 0;
+    int64_t maxInt = 0;
+    double minDouble = 0.0;
+    double maxDouble = 0.0;
+
+    void Include(int64_t v)
+    {
+        minInt = hasValues ? std::min(minInt, v) : v;
+        maxInt = hasValues ? std::max(maxInt, v) : v;
+        hasValues = true;
+    }
+
+    void Include(double v)
+    {
+        minDouble = hasValues ? std::min(minDouble, v) : v;
+        maxDouble = hasValues ? std::max(maxDouble, v) : v;
+        hasValues = true;
+    }
+};
+
+// One column of one row group: a fixed array of kRowGroupSize values plus a null bitmap.
+// A sealed INT chunk may instead point at an encoded PackedInts block.
+struct ColumnChunk
+{
+    void* values = nullptr;
+    uint64_t* nulls = nullptr;
+    IntEncoding encoding = IntEncoding::Plain;
+    ZoneMap zone;
+};
+
+struct ColumnData
+{
+    StorageKind kind = StorageKind::Json;
+    std::vector<ColumnChunk> chunks;
+    std::vector<json> jsonValues;  // StorageKind::Json only, indexed by row
+
+    // String columns start dictionary-encoded: chunks then hold uint32 codes into `dict`
+    // instead of one string slot per row. Codes are never reused until compaction.
+    bool dictionary = false;
+    std::vector<StringSlot> dict;
+    std::unordered_map<std::string_view, uint32_t> dictCodes;  // views into `dict` slots
+
+    // Int64 columns with `packed` set compress each row group once it is full. Only the
+    // open (last) group is written in place, in `openInts`, which every group reuses.
+    bool packed = false;
+    int64_t* openInts = nullptr;
+};
+
+// Column-major row storage for one table. Fixed-width values and null bitmaps are
+// bump-allocated from `arena`; text lives in `strings`. Everything is released
+// together by Clear() or when the storage is destroyed.
+class TableStorage
+{
+public:
+    TableStorage() = default;
+    TableStorage(const TableStorage&) = delete;
+    TableStorage& operator=(const TableStorage&) = delete;
+    TableStorage(TableStorage&& other) noexcept { *this = std::move(other); }
+    TableStorage& operator=(TableStorage&& other) noexcept
+    {
+        if (this == &other) return *this;
+        columns = std::move(other.columns);
+        rowCount = other.rowCount;
+        other.rowCount = 0;
+        strings = std::move(other.strings);
+        arena = std::move(other.arena);
+        return *this;
+    }
+
+    size_t RowCount() const { return rowCount; }
+    size_t ColumnCount() const { return columns.size(); }
+    StorageKind Kind(size_t col) const { return columns[col].kind; }
+    const ColumnData& Column(size_t col) const { return columns[col]; }
+
+    void AddColumn(StorageKind kind) { AddColumn(kind, kind == StorageKind::String || kind == StorageKind::Int64); }
+
+    // `encoded`: dictionary encoding for String columns, packed row groups for Int64 columns
+    void AddColumn(StorageKind kind, bool encoded)
+    {
+        if (rowCount != 0)
+            throw std::runtime_error("Cannot add a column to a table that has rows");
+        ColumnData c;
+        c.kind = kind;
+        c.dictionary = encoded && kind == StorageKind::String;
+        c.packed = encoded && kind == StorageKind::Int64;
+        columns.push_back(std::move(c));
+    }
+
+    // `values` must hold one already type-checked value per column
+    size_t AppendRow(const std::vector<json>& values)
+    {
+        size_t row = rowCount;
+        if (row % kRowGroupSize == 0) AddRowGroup();
+        ++rowCount;
+
+        for (size_t c = 0; c < columns.size(); ++c)
+        {
+            if (columns[c].kind == StorageKind::Json)
+                columns[c].jsonValues.emplace_back();
+            Write(row, c, values[c]);
+        }
+        return row;
+    }
+
+    // Copies one row of another storage with the same columns, value by value
+    size_t AppendRowFrom(const TableStorage& src, size_t srcRow)
+    {
+        size_t row = rowCount;
+        if (row % kRowGroupSize == 0) AddRowGroup();
+        ++rowCount;
+
+        for (size_t c = 0; c < columns.size(); ++c)
+        {
+            auto& col = columns[c];
+            if (col.kind == StorageKind::Json)
+                col.jsonValues.push_back(src.columns[c].jsonValues[srcRow]);
+
+            if (src.IsNull(srcRow, c))
+            {
+                SetNullBit(row, c, true);
+                continue;
+            }
+
+            switch (col.kind)
+            {
+            case StorageKind::Int64:
+                IntSlot(row, c) = src.GetInt(srcRow, c);
+                Zone(row, c).Include(IntSlot(row, c));
+                break;
+            case StorageKind::Double:
+                DoubleSlot(row, c) = src.GetDouble(srcRow, c);
+                Zone(row, c).Include(DoubleSlot(row, c));
+                break;
+            case StorageKind::String: WriteString(row, c, src.GetString(srcRow, c)); break;
+            case StorageKind::Json: break;
+            }
+        }
+        return row;
+    }
+
+    bool IsNull(size_t row, size_t col) const
+    {
+        const uint64_t* bits = columns[col].chunks[row / kRowGroupSize].nulls;
+        size_t i = row % kRowGroupSize;
+        return (bits[i >> 6] >> (i & 63)) & 1;
+    }
+
+    int64_t GetInt(size_t row, size_t col) const
+    {
+        const ColumnChunk& chunk = columns[col].chunks[row / kRowGroupSize];
+        if (chunk.encoding != IntEncoding::Plain)
+            return PackedIntAt(static_cast<const PackedInts*>(chunk.values), row % kRowGroupSize);
+        return static_cast<const int64_t*>(chunk.values)[row % kRowGroupSize];
+    }
+
+    // All kRowGroupSize values of one INT row group, decoded into `out` if the group is packed
+    const int64_t* IntGroup(size_t group, size_t col, int64_t* out) const
+    {
+        const ColumnChunk& chunk = columns[col].chunks[group];
+        if (chunk.encoding == IntEncoding::Plain)
+            return static_cast<const int64_t*>(chunk.values);
+        DecodeInts(static_cast<const PackedInts*>(chunk.values), out);
+        return out;
+    }
+
+    size_t GroupCount() const { return (rowCount + kRowGroupSize - 1) / kRowGroupSize; }
+    const ColumnChunk& Chunk(size_t group, size_t col) const { return columns[col].chunks[group]; }
+
+    double GetDouble(size_t row, size_t col) const
+    {
+        return static_cast<const double*>(columns[col].chunks[row / kRowGroupSize].values)[row % kRowGroupSize];
+    }
+
+    std::string_view GetString(size_t row, size_t col) const
+    {
+        const auto& c = columns[col];
+        if (c.dictionary) return StringPool::View(c.dict[GetCode(row, col)]);
+        const auto* slots = static_cast<const StringSlot*>(c.chunks[row / kRowGroupSize].values);
+        return StringPool::View(slots[row % kRowGroupSize]);
+    }
+
+    // Dictionary-encoded columns only
+    uint32_t GetCode(size_t row, size_t col) const
+    {
+        return static_cast<const uint32_t*>(columns[col].chunks[row / kRowGroupSize].values)[row % kRowGroupSize];
+    }
+
+    bool FindCode(size_t col, std::string_view s, uint32_t& code) const
+    {
+        const auto& codes = columns[col].dictCodes;
+        auto it = codes.find(s);
+        if (it == codes.end()) return false;
+        code = it->second;
+        return true;
+    }
+
+    json Get(size_t row, size_t col) const
+    {
+        const auto& c = columns[col];
+        if (c.kind == StorageKind::Json) return c.jsonValues[row];
+        if (IsNull(row, col)) return json();
+
+        switch (c.kind)
+        {
+        case StorageKind::Int64: return GetInt(row, col);
+        case StorageKind::Double: return GetDouble(row, col);
+        case StorageKind::String: return std::string(GetString(row, col));
+        default: return json();
+        }
+    }
+
+    void Set(size_t row, size_t col, const json& v) { Write(row, col, v); }
+
+    // Drops every row and hands all pages back to the OS
+    void Clear()
+    {
+        for (auto& c : columns)
+        {
+            c.chunks.clear();
+            c.chunks.shrink_to_fit();
+            std::vector<json>().swap(c.jsonValues);
+            std::vector<StringSlot>().swap(c.dict);
+            c.dictCodes = {};
+            c.openInts = nullptr;
+        }
+        rowCount = 0;
+        strings.Release();
+        arena.Release();
+    }
+
+    const Arena& ValueArena() const { return arena; }
+    const StringPool& Strings() const { return strings; }
+
+    // Bytes per row in the column's chunks (0 for JSON columns, which have none)
+    size_t ValueWidth(size_t col) const
+    {
+        switch (columns[col].kind)
+        {
+        case StorageKind::Int64: return sizeof(int64_t);
+        case StorageKind::Double: return sizeof(double);
+        case StorageKind::String: return columns[col].dictionary ? sizeof(uint32_t) : sizeof(StringSlot);
+        case StorageKind::Json: return 0;
+        }
+        return 0;
+    }
+
+private:
+    void AddRowGroup()
+    {
+        for (size_t col = 0; col < columns.size(); ++col)
+        {
+            auto& c = columns[col];
+            ColumnChunk chunk;
+            size_t width = ValueWidth(col);
+            if (c.packed)
+            {
+                if (!c.chunks.empty()) SealIntChunk(c.chunks.size() - 1, col);
+                if (!c.openInts)
+                    c.openInts = static_cast<int64_t*>(arena.Allocate(sizeof(int64_t) * kRowGroupSize, 64));
+                std::memset(c.openInts, 0, sizeof(int64_t) * kRowGroupSize);
+                chunk.values = c.openInts;
+            }
+            else if (width)
+            {
+                chunk.values = arena.Allocate(width * kRowGroupSize, 64);
+                std::memset(chunk.values, 0, width * kRowGroupSize);
+                if (c.kind == StorageKind::String && !c.dictionary)
+                {
+                    auto* slots = static_cast<StringSlot*>(chunk.values);
+                    std::fill(slots, slots + kRowGroupSize, StringSlot());
+                }
+            }
+            chunk.nulls = static_cast<uint64_t*>(arena.Allocate(kNullWords * sizeof(uint64_t), 64));
+            std::memset(chunk.nulls, 0, kNullWords * sizeof(uint64_t));
+            c.chunks.push_back(chunk);
+        }
+    }
+
+    // Encodes a full INT row group out of the open buffer. If no encoding beats the raw
+    // values they are copied out as they are, so the buffer can be reused either way.
+    void SealIntChunk(size_t group, size_t col)
+    {
+        ColumnChunk& chunk = columns[col].chunks[group];
+        auto* v = static_cast<int64_t*>(chunk.values);
+
+        // null slots hold stale values; give them a neighbour's so they don't widen the encoding
+        int64_t fill = 0;
+        bool seen = false;
+        for (size_t i = 0; i < kRowGroupSize; ++i)
+        {
+            if (!IsNull(group * kRowGroupSize + i, col))
+            {
+                fill = v[i];
+                if (!seen) std::fill(v, v + i, fill);
+                seen = true;
+            }
+            else if (seen) v[i] = fill;
+        }
+
+        auto block = EncodeInts(v, kRowGroupSize);
+        const auto* header = reinterpret_cast<const PackedInts*>(block.data());
+        if (header->encoding == IntEncoding::Plain)
+        {
+            void* copy = arena.Allocate(sizeof(int64_t) * kRowGroupSize, 64);
+            std::memcpy(copy, v, sizeof(int64_t) * kRowGroupSize);
+            chunk.values = copy;
+            return;
+        }
+
+        size_t bytes = PackedSizeBytes(header);
+        chunk.values = arena.Allocate(bytes, 64);
+        std::memcpy(chunk.values, block.data(), bytes);
+        chunk.encoding = header->encoding;
+    }
+
+    // Turns a sealed INT row group back into raw values so one of them can be written.
+    // The encoded block stays in the arena until the next compaction.
+    void UnpackIntChunk(size_t group, size_t col)
+    {
+        ColumnChunk& chunk = columns[col].chunks[group];
+        auto* values = static_cast<int64_t*>(arena.Allocate(sizeof(int64_t) * kRowGroupSize, 64));
+        DecodeInts(static_cast<const PackedInts*>(chunk.values), values);
+        chunk.values = values;
+        chunk.encoding = IntEncoding::Plain;
+    }
+
+    ZoneMap& Zone(size_t row, size_t col)
+    {
+        return columns[col].chunks[row / kRowGroupSize].zone;
+    }
+
+    // Also keeps the group's null count; rows start out non-null
+    void SetNullBit(size_t row, size_t col, bool isNull)
+    {
+        ColumnChunk& chunk = columns[col].chunks[row / kRowGroupSize];
+        size_t i = row % kRowGroupSize;
+        uint64_t mask = uint64_t(1) << (i & 63);
+        bool wasNull = chunk.nulls[i >> 6] & mask;
+        if (isNull == wasNull) return;
+
+        if (isNull)
+        {
+            chunk.nulls[i >> 6] |= mask;
+            ++chunk.zone.nullCount;
+        }
+        else
+        {
+            chunk.nulls[i >> 6] &= ~mask;
+            --chunk.zone.nullCount;
+        }
+    }
+
+    int64_t& IntSlot(size_t row, size_t col)
+    {
+        return static_cast<int64_t*>(columns[col].chunks[row / kRowGroupSize].values)[row % kRowGroupSize];
+    }
+
+    double& DoubleSlot(size_t row, size_t col)
+    {
+        return static_cast<double*>(columns[col].chunks[row / kRowGroupSize].values)[row % kRowGroupSize];
+    }
+
+    StringSlot& StrSlot(size_t row, size_t col)
+    {
+        return static_cast<StringSlot*>(columns[col].chunks[row / kRowGroupSize].values)[row % kRowGroupSize];
+    }
+
+    uint32_t& CodeSlot(size_t row, size_t col)
+    {
+        return static_cast<uint32_t*>(columns[col].chunks[row / kRowGroupSize].values)[row % kRowGroupSize];
+    }
+
+    // Code of `s` in the column's dictionary, adding it if there is room
+    bool Intern(ColumnData& c, std::string_view s, uint32_t& code)
+    {
+        auto it = c.dictCodes.find(s);
+        if (it != c.dictCodes.end())
+        {
+            code = it->second;
+            return true;
+        }
+        if (c.dict.size() >= kDictionaryMaxEntries) return false;
+
+        code = static_cast<uint32_t>(c.dict.size());
+        c.dict.push_back(strings.Store(s));
+        c.dictCodes.emplace(StringPool::View(c.dict.back()), code);
+        return true;
+    }
+
+    // Re-encodes a dictionary column with one string slot per row. The code chunks
+    // stay in the arena until the next compaction.
+    void ConvertToPlain(size_t col)
+    {
+        auto& c = columns[col];
+        for (size_t g = 0; g < c.chunks.size(); ++g)
+        {
+            const auto* codes = static_cast<const uint32_t*>(c.chunks[g].values);
+            auto* slots = static_cast<StringSlot*>(arena.Allocate(sizeof(StringSlot) * kRowGroupSize, 64));
+            std::fill(slots, slots + kRowGroupSize, StringSlot());
+
+            size_t n = std::min(kRowGroupSize, rowCount - g * kRowGroupSize);
+            for (size_t i = 0; i < n; ++i)
+                if (!IsNull(g * kRowGroupSize + i, col))
+                    slots[i] = strings.Store(StringPool::View(c.dict[codes[i]]));
+            c.chunks[g].values = slots;
+        }
+
+        for (auto& slot : c.dict)
+            strings.Free(slot);
+        std::vector<StringSlot>().swap(c.dict);
+        c.dictCodes = {};
+        c.dictionary = false;
+    }
+
+    void WriteString(size_t row, size_t col, std::string_view s)
+    {
+        auto& c = columns[col];
+        uint32_t code = 0;
+        if (c.dictionary && !Intern(c, s, code))
+            ConvertToPlain(col);
+
+        if (c.dictionary)
+            CodeSlot(row, col) = code;
+        else
+        {
+            StringSlot& slot = StrSlot(row, col);
+            if (!IsNull(row, col)) strings.Free(slot);
+            slot = strings.Store(s);
+        }
+        SetNullBit(row, col, false);
+    }
+
+    void Write(size_t row, size_t col, const json& v)
+    {
+        auto& c = columns[col];
+        if (c.kind == StorageKind::Json)
+        {
+            c.jsonValues[row] = v;
+            SetNullBit(row, col, v.is_null());
+            return;
+        }
+
+        if (v.is_null())
+        {
+            if (c.kind == StorageKind::String && !c.dictionary && !IsNull(row, col))
+                strings.Free(StrSlot(row, col));
+            SetNullBit(row, col, true);
+            return;
+        }
+
+        switch (c.kind)
+        {
+        case StorageKind::Int64:
+            if (c.chunks[row / kRowGroupSize].encoding != IntEncoding::Plain)
+                UnpackIntChunk(row / kRowGroupSize, col);
+            IntSlot(row, col) = v.get<int64_t>();
+            Zone(row, col).Include(IntSlot(row, col));
+            break;
+        case StorageKind::Double:
+            DoubleSlot(row, col) = v.get<double>();
+            Zone(row, col).Include(DoubleSlot(row, col));
+            break;
+        case StorageKind::String: WriteString(row, col, v.get_ref<const std::string&>()); return;
+        case StorageKind::Json: break;
+        }
+        SetNullBit(row, col, false);
+    }
+
+    std::vector<ColumnData> columns;
+    size_t rowCount = 0;
+    Arena arena;
+    StringPool strings;
+};
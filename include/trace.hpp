@@ -0,0 +1,200 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+/* =======================
+   TRACE SPANS
+   ======================= */
+
+// Scoped spans around the expensive phases of loading, saving and running queries:
+//
+//   TRACE_SPAN("json::parse");
+//   TRACE_SPAN_ARG("Deserialize table", tableName);
+//
+// Each span records its start and duration in nanoseconds into a buffer owned by the
+// current thread; WriteChromeTrace exports every thread's spans as Chrome trace-event
+// JSON, which chrome://tracing and Perfetto (ui.perfetto.dev) open directly.
+//
+// Spans are compiled in only when ENABLE_TRACING is defined (cmake -DENABLE_TRACING=ON).
+// Otherwise the macros expand to nothing and tracing costs nothing at all. A tracing
+// build records from process start, so the load of database.json is always covered.
+
+#ifdef ENABLE_TRACING
+inline constexpr bool kTracingEnabled = true;
+#else
+inline constexpr bool kTracingEnabled = false;
+#endif
+
+struct TraceEvent
+{
+    const char* name;   // a string literal
+    uint64_t startNs;   // since TraceEpoch()
+    uint64_t durNs;
+    std::string arg;    // optional detail (table, file, query text)
+};
+
+// Per-thread buffers are capped so a long session cannot grow without bound; later
+// spans are counted as dropped
+constexpr size_t kMaxTraceEventsPerThread = 1 << 20;
+
+struct TraceBuffer
+{
+    // Only taken by the owning thread and by export/reset, so it is almost never contended
+    std::mutex mutex;
+    std::vector<TraceEvent> events;
+    uint64_t dropped = 0;
+    uint32_t tid = 0;
+};
+
+class TraceRegistry
+{
+public:
+    std::shared_ptr<TraceBuffer> Register()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto b = std::make_shared<TraceBuffer>();
+        b->tid = static_cast<uint32_t>(buffers.size() + 1);
+        buffers.push_back(b);
+        return b;
+    }
+
+    std::vector<std::shared_ptr<TraceBuffer>> Buffers()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return buffers;
+    }
+
+private:
+    std::mutex mutex;
+    // kept after their thread exits so its spans can still be exported
+    std::vector<std::shared_ptr<TraceBuffer>> buffers;
+};
+
+inline TraceRegistry& GlobalTraceRegistry()
+{
+    static TraceRegistry registry;
+    return registry;
+}
+
+inline std::chrono::steady_clock::time_point TraceEpoch()
+{
+    static const auto epoch = std::chrono::steady_clock::now();
+    return epoch;
+}
+
+inline uint64_t TraceNowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - TraceEpoch()).count());
+}
+
+inline TraceBuffer& ThreadTraceBuffer()
+{
+    thread_local std::shared_ptr<TraceBuffer> buffer = GlobalTraceRegistry().Register();
+    return *buffer;
+}
+
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char* name) : name(name), start(TraceNowNs()) {}
+    TraceSpan(const char* name, std::string arg) : name(name), arg(std::move(arg)), start(TraceNowNs()) {}
+
+    ~TraceSpan()
+    {
+        uint64_t end = TraceNowNs();
+        TraceBuffer& b = ThreadTraceBuffer();
+        std::lock_guard<std::mutex> lock(b.mutex);
+        if (b.events.size() >= kMaxTraceEventsPerThread)
+        {
+            ++b.dropped;
+            return;
+        }
+        b.events.push_back({ name, start, end - start, std::move(arg) });
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name;
+    std::string arg;
+    uint64_t start;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef ENABLE_TRACING
+#define TRACE_SPAN(name) TraceSpan TRACE_CONCAT(traceSpan_, __LINE__)(name)
+#define TRACE_SPAN_ARG(name, arg) TraceSpan TRACE_CONCAT(traceSpan_, __LINE__)(name, arg)
+#else
+#define TRACE_SPAN(name) ((void)0)
+#define TRACE_SPAN_ARG(name, arg) ((void)0)
+#endif
+
+/* =======================
+   CHROME TRACE EXPORT
+   ======================= */
+
+// Writes {"traceEvents": [...]} with one complete ("X") event per span; timestamps are
+// microseconds with nanosecond fractions. Returns the number of spans written.
+inline size_t WriteChromeTrace(std::ostream& out)
+{
+    size_t written = 0;
+    uint64_t dropped = 0;
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+    bool first = true;
+    auto separator = [&] {
+        if (!first) out << ",\n";
+        first = false;
+    };
+
+    for (const auto& b : GlobalTraceRegistry().Buffers())
+    {
+        std::lock_guard<std::mutex> lock(b->mutex);
+        dropped += b->dropped;
+
+        separator();
+        out << nlohmann::json{
+            {"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", b->tid},
+            {"args", {{"name", b->tid == 1 ? "main" : "thread " + std::to_string(b->tid)}}}
+        }.dump();
+
+        for (const auto& e : b->events)
+        {
+            nlohmann::json j = {
+                {"name", e.name}, {"cat", "db"}, {"ph", "X"}, {"pid", 1}, {"tid", b->tid},
+                {"ts", static_cast<double>(e.startNs) / 1e3},
+                {"dur", static_cast<double>(e.durNs) / 1e3}
+            };
+            if (!e.arg.empty()) j["args"] = {{"detail", e.arg}};
+            separator();
+            out << j.dump();
+            ++written;
+        }
+    }
+
+    out << "],\"otherData\":{\"dropped_spans\":" << dropped << "}}\n";
+    return written;
+}
+
+// Discards every span recorded so far
+inline void ResetTrace()
+{
+    for (const auto& b : GlobalTraceRegistry().Buffers())
+    {
+        std::lock_guard<std::mutex> lock(b->mutex);
+        b->events.clear();
+        b->dropped = 0;
+    }
+}
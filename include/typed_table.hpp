@@ -0,0 +1,357 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <database.hpp>
+#include <planner.hpp>
+
+/* =======================
+   TYPED SCHEMAS
+   ======================= */
+
+// A C++ program embedding the database can declare a table as a plain struct:
+//
+//   struct Student { int64_t id; std::string name; int64_t year; std::optional<double> gpa; };
+//   TYPED_SCHEMA(Student, "students",
+//       TYPED_FIELD(Student, id, kPrimaryKey),
+//       TYPED_FIELD(Student, name),
+//       TYPED_FIELD(Student, year),
+//       TYPED_FIELD(Student, gpa));
+//
+//   TypedTable<Student> students(db);
+//   students.Insert({ 1, "Alice", 2024, 3.7 });
+//   auto rows = students.Select<&Student::year>(2024);
+//
+// The table is an ordinary Table in the Database, so ExecuteQuery, indexes and
+// serialization see it like any other; the typed side just reads and writes columns by
+// position instead of through Entity::fields.
+
+enum FieldFlags : unsigned
+{
+    kNoFlags = 0,
+    kPrimaryKey = 1,
+    kNotNull = 2
+};
+
+template <typename Row, typename T>
+struct Field
+{
+    using Type = T;
+
+    const char* name;
+    T Row::*member;
+    unsigned flags = kNoFlags;
+};
+
+template <typename Row, typename T>
+constexpr Field<Row, T> MakeField(const char* name, T Row::*member, unsigned flags = kNoFlags)
+{
+    return { name, member, flags };
+}
+
+// Specialized (usually through TYPED_SCHEMA) with `table` and a tuple of Fields
+template <typename Row>
+struct Schema;
+
+#define TYPED_SCHEMA(RowType, tableName, ...)                                      \
+    template <>                                                                    \
+    struct Schema<RowType>                                                         \
+    {                                                                              \
+        static constexpr const char* table = tableName;                            \
+        static constexpr auto fields = std::make_tuple(__VA_ARGS__);               \
+    }
+
+#define TYPED_FIELD(RowType, member, ...) MakeField(#member, &RowType::member __VA_OPT__(,) __VA_ARGS__)
+
+// How a C++ member type maps onto a column: its DType, conversion to the JSON form used
+// by inserts and predicates, and a direct read from column storage
+template <typename T>
+struct FieldType;
+
+template <>
+struct FieldType<int64_t>
+{
+    static constexpr DType type = DType::INT;
+    static constexpr bool nullable = false;
+    static json ToJson(int64_t v) { return v; }
+    static int64_t FromJson(const json& v) { return v.is_null() ? 0 : v.get<int64_t>(); }
+    static int64_t Read(const TableStorage& st, size_t row, size_t col)
+    {
+        return st.IsNull(row, col) ? 0 : st.GetInt(row, col);
+    }
+};
+
+template <>
+struct FieldType<int32_t>
+{
+    static constexpr DType type = DType::INT;
+    static constexpr bool nullable = false;
+    static json ToJson(int32_t v) { return static_cast<int64_t>(v); }
+    static int32_t FromJson(const json& v) { return v.is_null() ? 0 : v.get<int32_t>(); }
+    static int32_t Read(const TableStorage& st, size_t row, size_t col)
+    {
+        return st.IsNull(row, col) ? 0 : static_cast<int32_t>(st.GetInt(row, col));
+    }
+};
+
+template <>
+struct FieldType<double>
+{
+    static constexpr DType type = DType::REAL;
+    static constexpr bool nullable = false;
+    static json ToJson(double v) { return v; }
+    static double FromJson(const json& v) { return v.is_null() ? 0.0 : v.get<double>(); }
+    static double Read(const TableStorage& st, size_t row, size_t col)
+    {
+        return st.IsNull(row, col) ? 0.0 : st.GetDouble(row, col);
+    }
+};
+
+template <>
+struct FieldType<std::string>
+{
+    static constexpr DType type = DType::TEXT;
+    static constexpr bool nullable = false;
+    static json ToJson(const std::string& v) { return v; }
+    static std::string FromJson(const json& v) { return v.is_null() ? std::string() : v.get<std::string>(); }
+    static std::string Read(const TableStorage& st, size_t row, size_t col)
+    {
+        return st.IsNull(row, col) ? std::string() : std::string(st.GetString(row, col));
+    }
+};
+
+template <>
+struct FieldType<json>
+{
+    static constexpr DType type = DType::RELATION;
+    static constexpr bool nullable = true;
+    static json ToJson(const json& v) { return v; }
+    static json FromJson(const json& v) { return v; }
+    static json Read(const TableStorage& st, size_t row, size_t col) { return st.Get(row, col); }
+};
+
+// std::optional members are nullable columns; everything else is NOT NULL
+template <typename T>
+struct FieldType<std::optional<T>>
+{
+    static constexpr DType type = FieldType<T>::type;
+    static constexpr bool nullable = true;
+
+    static json ToJson(const std::optional<T>& v) { return v ? FieldType<T>::ToJson(*v) : json(); }
+
+    static std::optional<T> FromJson(const json& v)
+    {
+        if (v.is_null()) return std::nullopt;
+        return FieldType<T>::FromJson(v);
+    }
+
+    static std::optional<T> Read(const TableStorage& st, size_t row, size_t col)
+    {
+        if (st.IsNull(row, col)) return std::nullopt;
+        return FieldType<T>::Read(st, row, col);
+    }
+};
+
+/* =======================
+   TYPED TABLE
+   ======================= */
+
+// Statically typed view of the table declared by Schema<Row>. Row must be default
+// constructible. Column positions are resolved once when the view is created.
+template <typename Row>
+class TypedTable
+{
+public:
+    static constexpr size_t kFieldCount = std::tuple_size_v<decltype(Schema<Row>::fields)>;
+
+    // Uses the schema's table in `db`, creating it when missing. An existing table (e.g.
+    // created by CREATE TABLE or loaded from database.json) must have exactly the
+    // schema's columns, with matching types, in any order.
+    explicit TypedTable(Database& db)
+    {
+        auto it = db.GetTables().find(Schema<Row>::table);
+        if (it == db.GetTables().end())
+            Create(db);
+        else
+            Bind(*it->second);
+    }
+
+    Table& table() { return *t; }
+    const Table& table() const { return *t; }
+
+    void Insert(const Row& r)
+    {
+        std::vector<RowValues> rows;
+        rows.push_back(BuildValues(r));
+        CheckPrimaryKeys(*t, rows);
+        AppendRows(*t, std::move(rows));
+    }
+
+    // All rows are validated before any is applied, as with INSERT batches
+    size_t Insert(const std::vector<Row>& rs)
+    {
+        std::vector<RowValues> rows;
+        rows.reserve(rs.size());
+        for (const auto& r : rs)
+            rows.push_back(BuildValues(r));
+        CheckPrimaryKeys(*t, rows);
+        AppendRows(*t, std::move(rows));
+        return rs.size();
+    }
+
+    Row Read(size_t row) const
+    {
+        Row r;
+        ForEachField([&](auto i, const auto& f) {
+            using T = typename std::remove_cvref_t<decltype(f)>::Type;
+            r.*(f.member) = FieldType<T>::Read(t->storage, row, cols[i]);
+        });
+        return r;
+    }
+
+    // Rows where `Member op value`, through the same access paths (index lookup or
+    // filtered scan) as SELECT
+    template <auto Member, typename V>
+    std::vector<Row> Select(const V& value, CompareOp op = CompareOp::EQ) const
+    {
+        constexpr size_t i = FieldIndex<Member>();
+        using T = typename std::tuple_element_t<i, decltype(Schema<Row>::fields)>::Type;
+
+        Predicate p;
+        p.column.column = std::get<i>(Schema<Row>::fields).name;
+        p.column.index = cols[i];
+        p.op = op;
+        p.value = FieldType<T>::ToJson(value);
+
+        std::vector<Row> result;
+        OperatorPtr scan = PlanAccessPath(*t, 0, { p });
+        TupleBatch batch(1);
+        scan->Open();
+        while (scan->NextBatch(batch))
+            for (uint32_t pos : batch.sel)
+                result.push_back(Read(batch.ids[0][pos]));
+        return result;
+    }
+
+    // Calls fn(const Row&) for every live row
+    template <typename F>
+    void ForEach(F&& fn) const
+    {
+        for (size_t i = 0; i < t->RowCount(); ++i)
+            if (!t->IsDeleted(i)) fn(Read(i));
+    }
+
+    // Conversions for rows that went through the dynamic path (ExecuteQuery results,
+    // INSERT text)
+    static Row FromEntity(const Entity& e)
+    {
+        Row r;
+        ForEachField([&](auto, const auto& f) {
+            using T = typename std::remove_cvref_t<decltype(f)>::Type;
+            auto it = e.fields.find(f.name);
+            r.*(f.member) = FieldType<T>::FromJson(it == e.fields.end() ? json() : it->second.data);
+        });
+        return r;
+    }
+
+    static json ToJson(const Row& r)
+    {
+        json j = json::object();
+        ForEachField([&](auto, const auto& f) {
+            using T = typename std::remove_cvref_t<decltype(f)>::Type;
+            j[f.name] = FieldType<T>::ToJson(r.*(f.member));
+        });
+        return j;
+    }
+
+private:
+    Table* t = nullptr;
+    std::array<size_t, kFieldCount> cols{};
+
+    template <typename F>
+    static void ForEachField(F&& fn)
+    {
+        [&]<size_t... I>(std::index_sequence<I...>) {
+            (fn(std::integral_constant<size_t, I>{}, std::get<I>(Schema<Row>::fields)), ...);
+        }(std::make_index_sequence<kFieldCount>{});
+    }
+
+    template <auto Member, size_t I = 0>
+    static constexpr size_t FieldIndex()
+    {
+        if constexpr (I >= kFieldCount)
+        {
+            static_assert(I < kFieldCount, "member is not a field of the schema");
+            return I;
+        }
+        else
+        {
+            constexpr auto f = std::get<I>(Schema<Row>::fields);
+            if constexpr (std::is_same_v<decltype(f.member), decltype(Member)>)
+            {
+                if constexpr (f.member == Member) return I;
+                else return FieldIndex<Member, I + 1>();
+            }
+            else return FieldIndex<Member, I + 1>();
+        }
+    }
+
+    void Create(Database& db)
+    {
+        Table& table = db.CreateTable(Schema<Row>::table);
+        ForEachField([&](auto i, const auto& f) {
+            using T = typename std::remove_cvref_t<decltype(f)>::Type;
+            Attribute attr(f.name, FieldType<T>::type);
+            attr.isPrimaryKey = f.flags & kPrimaryKey;
+            attr.isNotNull = !FieldType<T>::nullable || (f.flags & (kNotNull | kPrimaryKey));
+            table.AddColumn(attr);
+            cols[i] = table.schema.size() - 1;
+            if (attr.isPrimaryKey) CreateIndex(table, attr.name);
+        });
+        t = &table;
+    }
+
+    void Bind(Table& table)
+    {
+        if (table.schema.size() != kFieldCount)
+            throw std::runtime_error("Table " + table.name + " does not match its typed schema");
+        ForEachField([&](auto i, const auto& f) {
+            using T = typename std::remove_cvref_t<decltype(f)>::Type;
+            size_t c = table.ColumnIndex(f.name);
+            if (StorageKindFor(table.schema[c].type) != StorageKindFor(FieldType<T>::type))
+                throw std::runtime_error("Type mismatch for column " + table.name + "." + f.name
+                    + ": table has " + DTypeName(table.schema[c].type));
+            cols[i] = c;
+        });
+        t = &table;
+    }
+
+    // One row in storage order, straight from the members
+    RowValues BuildValues(const Row& r) const
+    {
+        RowValues values(kFieldCount);
+        ForEachField([&](auto i, const auto& f) {
+            using T = typename std::remove_cvref_t<decltype(f)>::Type;
+            const Attribute& attr = t->schema[cols[i]];
+            json v = FieldType<T>::ToJson(r.*(f.member));
+            if (v.is_null() && attr.isNotNull)
+                throw std::runtime_error("Column cannot be null: " + attr.name);
+
+            // keep AUTO_INCREMENT of tables created through SQL ahead of typed inserts
+            if (attr.isAutoIncrement && v.is_number_integer())
+            {
+                auto& counter = t->autoIncCounters[attr.name];
+                counter = std::max(counter, v.get<int64_t>() + 1);
+            }
+            values[cols[i]] = std::move(v);
+        });
+        return values;
+    }
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+/* =======================
+   WORKLOAD CAPTURE
+   ======================= */
+
+// A captured workload is a JSON-lines file with one statement per line, in the order
+// ExecuteQuery received them:
+//
+//   {"t_us": 1532, "query": "SELECT students WHERE id = 7"}
+//
+// t_us is microseconds since capture started. The replay tool (tools/replay.cpp) runs
+// the statements against the snapshot saved next to the file when capture started.
+
+struct WorkloadEntry
+{
+    uint64_t offsetUs = 0;
+    std::string query;
+};
+
+inline std::string WorkloadSnapshotPath(const std::string& workloadPath)
+{
+    return workloadPath + ".db.json";
+}
+
+// Statements that only control instrumentation of the running process; they are not
+// captured, so a replay measures the same data work as the original run
+inline bool IsInstrumentationCommand(const std::string& word)
+{
+    return word == "STATS" || word == "SLOWLOG" || word == "TRACE" || word == "CAPTURE";
+}
+
+class WorkloadCapture
+{
+public:
+    ~WorkloadCapture() { Stop(); }
+
+    void Start(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (out.is_open()) out.close();
+        out.open(path, std::ios::binary | std::ios::trunc);
+        if (!out)
+            throw std::runtime_error("Cannot open workload capture file: " + path);
+        target = path;
+        captured.store(0, std::memory_order_relaxed);
+        start = std::chrono::steady_clock::now();
+        enabled.store(true, std::memory_order_release);
+    }
+
+    void Stop()
+    {
+        enabled.store(false, std::memory_order_release);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (out.is_open()) out.close();
+    }
+
+    bool Enabled() const { return enabled.load(std::memory_order_acquire); }
+    const std::string& Path() const { return target; }
+    uint64_t Captured() const { return captured.load(std::memory_order_relaxed); }
+
+    // Lines go through the stream's buffer; they reach the file when it fills or on Stop
+    void Record(const std::string& query)
+    {
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!out.is_open()) return;
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(now - start).count();
+        out << nlohmann::json{ {"t_us", us}, {"query", query} }.dump() << "\n";
+        captured.fetch_add(1, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<bool> enabled{ false };
+    std::mutex mutex;
+    std::ofstream out;
+    std::string target;
+    std::atomic<uint64_t> captured{ 0 };
+    std::chrono::steady_clock::time_point start;
+};
+
+inline WorkloadCapture& GlobalWorkloadCapture()
+{
+    static WorkloadCapture capture;
+    return capture;
+}
+
+inline std::vector<WorkloadEntry> ReadWorkload(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("Cannot open workload: " + path);
+
+    std::vector<WorkloadEntry> entries;
+    std::string line;
+    size_t lineNo = 0;
+    while (std::getline(in, line))
+    {
+        ++lineNo;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        try
+        {
+            auto j = nlohmann::json::parse(line);
+            entries.push_back({ j.at("t_us").get<uint64_t>(), j.at("query").get<std::string>() });
+        }
+        catch (const std::exception& e)
+        {
+            throw std::runtime_error(path + ":" + std::to_string(lineNo) + ": " + e.what());
+        }
+    }
+    return entries;
+}
@@ -0,0 +1,41 @@
+#include <alloc_tracker.hpp>
+
+#include <cstdlib>
+#include <new>
+
+// Replacement global allocation functions that keep a per-thread byte count.
+// The nothrow and array forms forward to these in the standard library.
+
+void* operator new(std::size_t size)
+{
+    if (size == 0) size = 1;
+    void* p = std::malloc(size);
+    if (!p) throw std::bad_alloc();
+    tl_allocatedBytes += size;
+    return p;
+}
+
+void* operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
@@ -1,23 +1,56 @@
 #include <application.hpp>
 #include <iostream>
 #include <filesystem>
+#include <fstream>
+#include <cstdlib>
+#include <cctype>
 
-Application::Application()
+Application::Application(ApplicationOptions opts) : options(std::move(opts))
 {
     db = std::make_shared<Database>("codeshark");
 
+    // script mode keeps stdout for results
+    std::ostream& log = Scripted() ? std::cerr : std::cout;
+
     // Load database only if file exists
-    if (std::filesystem::exists("database.json"))
+    if (std::filesystem::exists(options.dbPath))
+    {
+        LoadFromFile(*db, options.dbPath);
+        log << "[DB] Loaded " << options.dbPath << "\n";
+    }
+    else
     {
-        LoadFromFile(*db, "database.json");
-        std::cout << "[DB] Loaded database.json\n";
+        log << "[DB] No " << options.dbPath << " found, starting fresh (no default tables)\n";
+        if (!Scripted())
+            std::cout << "[Tip] Use: CREATE TABLE <name> (col TYPE, ...) to create tables\n";
     }
+
+    if (Scripted())
+        LoginForScript();
     else
+        LoginInteractive();
+}
+
+// A script cannot answer prompts: a database with credentials needs --user and the
+// password in the STUDENT_DB_PASSWORD environment variable
+void Application::LoginForScript()
+{
+    if (db->HasCredentials())
     {
-        std::cout << "[DB] No database.json found, starting fresh (no default tables)\n";
-        std::cout << "[Tip] Use: CREATE TABLE <name> (col TYPE, ...) to create tables\n";
+        const char* pass = std::getenv("STUDENT_DB_PASSWORD");
+        if (options.user.empty() || !pass || !db->Authenticate(options.user, pass))
+        {
+            std::cerr << "[Auth] Script mode needs --user and STUDENT_DB_PASSWORD for this database\n";
+            exitCode = 1;
+            return;
+        }
+        authenticated = true;
     }
+    running = true;
+}
 
+void Application::LoginInteractive()
+{
     // Authentication flow (optional)
     if (db->HasCredentials())
     {
@@ -68,7 +101,7 @@ Application::Application()
                 std::cout << "Passwords do not match, try again.\n";
             }
             db->SetCredentials(user, pass);
-            SaveToFile(*db, "database.json");
+            SaveToFile(*db, options.dbPath);
             std::cout << "[Auth] Credentials created and saved\n";
             authenticated = true; // newly created credentials -> mark as logged in
         }
@@ -83,6 +116,12 @@ Application::Application()
 
 void Application::Run()
 {
+    if (Scripted())
+    {
+        RunScript();
+        return;
+    }
+
     while (running)
     {
         try
@@ -107,9 +146,24 @@ void Application::Run()
                 {
                     std::cout << "Available commands:\n";
                     std::cout << "  CREATE TABLE <name> (col TYPE [AUTO_INCREMENT] [PRIMARY KEY] [NOT NULL] [DEFAULT <value>], ...)\n";
-                    std::cout << "  INSERT <TableName> {json}\n";
-                    std::cout << "  SELECT <TableName> [WHERE col = value]\n";
-                    std::cout << "  REMOVE <TableName> [WHERE col = value]\n";
+                    std::cout << "  CREATE INDEX ON <TableName> (col)\n";
+                    std::cout << "  INSERT <TableName> {json} | [{json}, ...] | FROM 'file.jsonl'\n";
+                    std::cout << "  SELECT <TableName> [JOIN <Other> ON a.col = b.col ...] [WHERE col op value [AND ...]]\n";
+                    std::cout << "  UPDATE <TableName> SET col = expr [, ...] [WHERE col op value [AND ...]]\n";
+                    std::cout << "  REMOVE <TableName> [WHERE col op value [AND ...]] [RETURNING]\n";
+                    std::cout << "  COMPACT <TableName>\n";
+                    std::cout << "  DROP TABLE <TableName>\n";
+                    std::cout << "  STORAGE [TableName]\n";
+                    std::cout << "  MEMORY [TableName]\n";
+                    std::cout << "  ANALYZE [TableName]\n";
+                    std::cout << "  EXPLAIN [ANALYZE] <SELECT|REMOVE ...>\n";
+                    std::cout << "  STATS [RESET | DUMP 'file' [seconds] | DUMP OFF]\n";
+                    std::cout << "  SLOWLOG ['file' [threshold_ms] | OFF]\n";
+                    std::cout << "  CAPTURE ['file' | OFF]\n";
+                    std::cout << "  CACHE [ON [max_mb] | OFF | CLEAR]\n";
+                    std::cout << "  FORMAT [table | csv | jsonl | tsv]\n";
+                    if (kTracingEnabled)
+                        std::cout << "  TRACE 'file' | TRACE RESET\n";
                     std::cout << "  exit\n";
                 }
                 else
@@ -119,10 +173,7 @@ void Application::Run()
                 continue;
             }
 
-            QueryResult result = ExecuteQuery(*db, input);
-
-            if (result.hasResult)
-                PrintResult(result);
+            ExecuteStatement(input);
         }
         catch (const std::exception& e)
         {
@@ -131,27 +182,151 @@ void Application::Run()
     }
 }
 
-Application::~Application()
+void Application::ExecuteStatement(const std::string& input)
 {
-    SaveToFile(*db, "database.json");
-    std::cout << "[DB] Saved database.json\n";
+    // FORMAT [table|csv|jsonl|tsv] only changes how this session prints results
+    size_t first = input.find_first_not_of(" \t\r");
+    if (first != std::string::npos && ToUpper(input.substr(first, 7)).rfind("FORMAT", 0) == 0
+        && (input.size() == first + 6 || std::isspace(static_cast<unsigned char>(input[first + 6]))))
+    {
+        QueryParser words(input);
+        words.Take();
+        if (words.AtEnd())
+            std::cout << "format: " << OutputFormatName(options.format) << "\n";
+        else
+        {
+            OutputFormat f = ParseOutputFormat(words.ExpectWord());
+            words.ExpectEnd();
+            options.format = f;
+        }
+        return;
+    }
+
+    // latency covers printing too: SELECT rows are produced while they are printed
+    CommandTimer timer(input);
+    try
+    {
+        QueryResult result = ExecuteQuery(*db, input);
+
+        if (result.hasResult)
+            PrintResult(result);
+    }
+    catch (...)
+    {
+        timer.Finish(false);
+        throw;
+    }
+    timer.Finish(true);
 }
 
-void Application::PrintResult(const QueryResult& result)
+// Runs the script one line per statement. Blank lines and lines starting with "--" or
+// "#" are skipped and "exit" ends the script early. Results go to stdout through its
+// buffer (no prompts, no per-line flushes); errors and the summary go to stderr.
+void Application::RunScript()
 {
-    if (result.rows.empty())
+    if (!running) return;
+
+    std::ifstream script(options.scriptPath);
+    if (!script)
     {
-        std::cout << "(no rows)\n";
+        std::cerr << "[Script] Cannot open " << options.scriptPath << "\n";
+        exitCode = 1;
         return;
     }
 
-    for (const auto& row : result.rows)
+    LatencyHistogram latency;
+    size_t statements = 0;
+    size_t errors = 0;
+    size_t lineNo = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    std::string line;
+    while (std::getline(script, line))
     {
-        std::cout << "{ ";
-        for (const auto& [key, value] : row.fields)
+        ++lineNo;
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line.compare(first, 2, "--") == 0 || line[first] == '#')
+            continue;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line == "exit") break;
+
+        auto began = std::chrono::steady_clock::now();
+        bool failed = false;
+        ++statements;
+        try
+        {
+            ExecuteStatement(line);
+        }
+        catch (const std::exception& e)
         {
-            std::cout << key << ": " << value.data << " ";
+            failed = true;
+            ++errors;
+            std::cerr << "[Error] " << options.scriptPath << ":" << lineNo << ": " << e.what() << "\n";
         }
-        std::cout << "}\n";
+        latency.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - began).count()));
+
+        if (failed && options.abortOnError)
+        {
+            aborted = true;
+            break;
+        }
+    }
+    std::cout.flush();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto ms = [](uint64_t ns) { return static_cast<double>(ns) / 1e6; };
+    std::cerr << "[Script] " << statements << " statements, " << errors << " errors in " << seconds << " s ("
+              << (seconds > 0.0 ? static_cast<double>(statements) / seconds : 0.0) << " statements/s)\n"
+              << "[Script] latency ms: mean " << (statements ? ms(latency.Sum()) / static_cast<double>(statements) : 0.0)
+              << ", p50 " << ms(latency.Percentile(0.50)) << ", p99 " << ms(latency.Percentile(0.99))
+              << ", p999 " << ms(latency.Percentile(0.999)) << ", max " << ms(latency.Max()) << "\n";
+    if (errors) exitCode = 1;
+}
+
+Application::~Application()
+{
+    // an aborted script leaves the database file as it was, so the script can be rerun
+    std::ostream& log = Scripted() ? std::cerr : std::cout;
+    if (aborted)
+    {
+        log << "[DB] Script aborted, " << options.dbPath << " not saved\n";
+        return;
+    }
+    if (Scripted() && !running) return;
+    SaveToFile(*db, options.dbPath);
+    log << "[DB] Saved " << options.dbPath << "\n";
+}
+
+void Application::PrintResult(QueryResult& result)
+{
+    TRACE_SPAN("PrintResult");
+    if (result.affectedRows && !result.cursor)
+    {
+        // machine-readable formats keep stdout for rows only
+        std::ostream& out = options.format == OutputFormat::Table ? std::cout : std::cerr;
+        out << "(" << *result.affectedRows << " row" << (*result.affectedRows == 1 ? "" : "s") << " affected)\n";
+        return;
+    }
+
+    // rows are written batch by batch as the cursor produces them
+    ResultWriter writer(std::cout, options.format);
+    writer.Begin(result.columns);
+
+    // a cached result is printed straight from the cache, in the same batch sizes
+    if (const std::vector<Entity>* shared = result.cursor ? result.cursor->TakeSharedRows() : nullptr)
+    {
+        std::span<const Entity> rows(*shared);
+        for (size_t pos = 0; pos < rows.size(); pos += kResultBatchSize)
+            writer.Rows(rows.subspan(pos, std::min(kResultBatchSize, rows.size() - pos)));
+        tl_executionCounters.rowsReturned += rows.size();
+    }
+
+    std::vector<Entity> batch;
+    while (result.cursor && result.cursor->NextBatch(batch))
+    {
+        tl_executionCounters.rowsReturned += batch.size();
+        writer.Rows(batch);
     }
+    writer.End();
 }
@@ -1,17 +1,57 @@
 #include <iostream>
 #include <application.hpp>
 #include <exception>
+#include <string>
 
-int main()
+namespace
 {
+
+int Usage()
+{
+    std::cerr << "usage: application [--db path] [--format table|csv|jsonl|tsv]\n"
+                 "                   [--script file.sql [--on-error continue|abort] [--user name]]\n";
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    ApplicationOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return Usage();
+        std::string v = argv[++i];
+
+        if (arg == "--db") options.dbPath = v;
+        else if (arg == "--script") options.scriptPath = v;
+        else if (arg == "--user") options.user = v;
+        else if (arg == "--format")
+        {
+            try { options.format = ParseOutputFormat(v); }
+            catch (const std::exception&) { return Usage(); }
+        }
+        else if (arg == "--on-error" && (v == "continue" || v == "abort")) options.abortOnError = v == "abort";
+        else return Usage();
+    }
+
+    // a script's output is only read at the end: let cout buffer instead of going
+    // through stdio line by line
+    if (!options.scriptPath.empty())
+        std::ios::sync_with_stdio(false);
+
+    int code = 0;
     try
     {
-        Application app;
+        Application app(options);
         app.Run();
+        code = app.ExitCode();
     }
     catch (const std::exception &e)
     {
         std::cout << "[Exception]: " << e.what() << std::endl;
+        code = 1;
     }
-    return 0;
-}
\ No newline at end of file
+    return code;
+}
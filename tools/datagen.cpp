@@ -0,0 +1,75 @@
+// Writes the synthetic dataset from datagen.hpp:
+//
+//   datagen [--seed N] [--students N] [--courses N] [--enrollments N] [--grades N]
+//           [--attendance N] [--skew S] [--format json|sql] [--batch N] [--out path]
+//
+// --format json writes a database.json that LoadFromFile reads directly; --format sql
+// writes one statement per line (CREATE TABLE, CREATE INDEX, batched INSERTs) for the
+// application's prompt or script mode. Output goes to stdout unless --out is given.
+
+#include <datagen.hpp>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace
+{
+
+int Usage()
+{
+    std::cerr << "usage: datagen [--seed N] [--students N] [--courses N] [--enrollments N] [--grades N]\n"
+                 "               [--attendance N] [--skew S] [--format json|sql] [--batch N] [--out path]\n";
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    DatasetConfig cfg;
+    std::string format = "json";
+    std::string outPath = "-";
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return Usage();
+        std::string v = argv[++i];
+
+        if (arg == "--seed") cfg.seed = std::strtoull(v.c_str(), nullptr, 10);
+        else if (arg == "--students") cfg.students = std::strtoull(v.c_str(), nullptr, 10);
+        else if (arg == "--courses") cfg.courses = std::strtoull(v.c_str(), nullptr, 10);
+        else if (arg == "--enrollments") cfg.enrollments = std::strtoull(v.c_str(), nullptr, 10);
+        else if (arg == "--grades") cfg.grades = std::strtoull(v.c_str(), nullptr, 10);
+        else if (arg == "--attendance") cfg.attendance = std::strtoull(v.c_str(), nullptr, 10);
+        else if (arg == "--skew") cfg.skew = std::strtod(v.c_str(), nullptr);
+        else if (arg == "--format") format = v;
+        else if (arg == "--batch") cfg.batch = std::max<size_t>(1, std::strtoull(v.c_str(), nullptr, 10));
+        else if (arg == "--out") outPath = v;
+        else return Usage();
+    }
+    if (format != "json" && format != "sql") return Usage();
+    if (std::string error = DatasetConfigError(cfg); !error.empty())
+    {
+        std::cerr << "datagen: " << error << "\n";
+        return Usage();
+    }
+
+    std::ofstream file;
+    if (outPath != "-")
+    {
+        file.open(outPath, std::ios::binary);
+        if (!file)
+        {
+            std::cerr << "cannot write " << outPath << "\n";
+            return 1;
+        }
+    }
+    std::ostream& out = outPath == "-" ? std::cout : file;
+
+    auto tables = DatasetTables(cfg);
+    if (format == "json") WriteDatasetJson(out, cfg, tables);
+    else WriteDatasetSql(out, cfg, tables);
+    return out ? 0 : 1;
+}
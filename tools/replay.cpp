@@ -0,0 +1,260 @@
+// Replays a workload captured with CAPTURE against the snapshot taken when capture began:
+//
+//   replay <workload.jsonl> [--db path] [--speed X] [--clients N] [--out report.json]
+//
+// --db defaults to <workload>.db.json (written by CAPTURE); without a snapshot the replay
+// starts from an empty database. --speed 1 (default) issues statements at their captured
+// times, --speed 10 ten times faster, --speed 0 as fast as possible. --clients N runs the
+// statements on N threads that take them in captured order, so up to N are in flight at
+// once; SELECTs share the database, every other statement runs alone, and a statement's
+// latency includes waiting for its turn. Captured order is kept: a statement that is not a
+// SELECT starts only after every earlier statement has finished, and a SELECT only after
+// every earlier one that is not.
+//
+// The report (JSON on stdout, or --out) has throughput, overall latency percentiles, how
+// far behind schedule statements started, and the per-command summaries STATS shows.
+
+#include <query.hpp>
+#include <workload.hpp>
+
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+int Usage()
+{
+    std::cerr << "usage: replay <workload.jsonl> [--db path] [--speed X] [--clients N] [--out report.json]\n";
+    return 2;
+}
+
+struct ReplayConfig
+{
+    std::string workload;
+    std::string dbPath;
+    double speed = 1.0;
+    size_t clients = 1;
+    std::string outPath;
+};
+
+// Whole-string numeric option values; false for anything else
+bool ParseCount(const std::string& v, size_t& out)
+{
+    char* end = nullptr;
+    if (v.empty() || !std::isdigit(static_cast<unsigned char>(v[0]))) return false;
+    unsigned long long n = std::strtoull(v.c_str(), &end, 10);
+    if (*end != '\0' || n == 0) return false;
+    out = static_cast<size_t>(n);
+    return true;
+}
+
+bool ParseSpeed(const std::string& v, double& out)
+{
+    char* end = nullptr;
+    out = std::strtod(v.c_str(), &end);
+    return !v.empty() && *end == '\0' && out >= 0.0 && std::isfinite(out);
+}
+
+// Tracks which statements have finished so each one can wait for those it depends on.
+// Entries finish out of order, so `done` is the length of the finished prefix.
+class ReplayOrder
+{
+public:
+    explicit ReplayOrder(const std::vector<WorkloadEntry>& entries) : finished(entries.size(), false)
+    {
+        // lastWrite[i] = 1 + index of the last non-SELECT before i (0 when there is none)
+        lastWrite.resize(entries.size());
+        size_t last = 0;
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            lastWrite[i] = last;
+            if (CommandKindOf(entries[i].query) != CommandKind::Select) last = i + 1;
+        }
+    }
+
+    // A SELECT needs every earlier write done; anything else needs every earlier statement
+    void WaitTurn(size_t i, bool select)
+    {
+        size_t need = select ? lastWrite[i] : i;
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return done >= need; });
+    }
+
+    void Finish(size_t i)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished[i] = true;
+            while (done < finished.size() && finished[done]) ++done;
+        }
+        changed.notify_all();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<bool> finished;
+    std::vector<size_t> lastWrite;
+    size_t done = 0;
+};
+
+nlohmann::json HistogramJson(const LatencyHistogram& h)
+{
+    auto ms = [](uint64_t ns) { return static_cast<double>(ns) / 1e6; };
+    uint64_t n = h.Count();
+    return {
+        {"count", n},
+        {"mean_ms", n ? ms(h.Sum()) / static_cast<double>(n) : 0.0},
+        {"p50_ms", ms(h.Percentile(0.50))},
+        {"p90_ms", ms(h.Percentile(0.90))},
+        {"p99_ms", ms(h.Percentile(0.99))},
+        {"p999_ms", ms(h.Percentile(0.999))},
+        {"max_ms", ms(h.Max())}
+    };
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    ReplayConfig cfg;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0)
+        {
+            if (!cfg.workload.empty()) return Usage();
+            cfg.workload = arg;
+            continue;
+        }
+        if (i + 1 >= argc) return Usage();
+        std::string v = argv[++i];
+
+        if (arg == "--db") cfg.dbPath = v;
+        else if (arg == "--speed") { if (!ParseSpeed(v, cfg.speed)) return Usage(); }
+        else if (arg == "--clients") { if (!ParseCount(v, cfg.clients)) return Usage(); }
+        else if (arg == "--out") cfg.outPath = v;
+        else return Usage();
+    }
+    if (cfg.workload.empty()) return Usage();
+    if (cfg.dbPath.empty() && std::filesystem::exists(WorkloadSnapshotPath(cfg.workload)))
+        cfg.dbPath = WorkloadSnapshotPath(cfg.workload);
+
+    Database db("replay");
+    std::vector<WorkloadEntry> entries;
+    try
+    {
+        if (!cfg.dbPath.empty()) LoadFromFile(db, cfg.dbPath);
+        entries = ReadWorkload(cfg.workload);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    std::shared_mutex dbLock;
+    ReplayOrder order(entries);
+    std::atomic<size_t> next{ 0 };
+    LatencyHistogram latency;
+    LatencyHistogram lag;  // how late each statement started relative to its schedule
+    auto start = std::chrono::steady_clock::now();
+
+    auto client = [&] {
+        while (true)
+        {
+            size_t i = next.fetch_add(1, std::memory_order_relaxed);
+            if (i >= entries.size()) return;
+            const WorkloadEntry& e = entries[i];
+
+            auto due = start;
+            if (cfg.speed > 0.0)
+            {
+                due += std::chrono::nanoseconds(static_cast<int64_t>(static_cast<double>(e.offsetUs) * 1000.0 / cfg.speed));
+                std::this_thread::sleep_until(due);
+                lag.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - due).count()));
+            }
+
+            CommandTimer timer(e.query);
+            auto began = std::chrono::steady_clock::now();
+            bool select = CommandKindOf(e.query) == CommandKind::Select;
+            bool ok = true;
+            order.WaitTurn(i, select);
+            try
+            {
+                if (select)
+                {
+                    std::shared_lock<std::shared_mutex> lock(dbLock);
+                    QueryResult result = ExecuteQuery(db, e.query);
+                    if (const auto* shared = result.cursor ? result.cursor->TakeSharedRows() : nullptr)
+                        tl_executionCounters.rowsReturned += shared->size();
+                    tl_executionCounters.rowsReturned += result.Drain().size();
+                }
+                else
+                {
+                    std::unique_lock<std::shared_mutex> lock(dbLock);
+                    ExecuteQuery(db, e.query).Drain();
+                }
+            }
+            catch (const std::exception&)
+            {
+                ok = false;
+            }
+            order.Finish(i);
+            timer.Finish(ok);
+            latency.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - began).count()));
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t c = 0; c < cfg.clients; ++c)
+        threads.emplace_back(client);
+    for (auto& t : threads)
+        t.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t errors = 0;
+    nlohmann::json commands = nlohmann::json::array();
+    for (const auto& s : GlobalQueryStats().Summaries())
+    {
+        errors += s.errors;
+        commands.push_back(s.ToJson());
+    }
+
+    double capturedSeconds = entries.empty() ? 0.0 : static_cast<double>(entries.back().offsetUs) / 1e6;
+    nlohmann::json report = {
+        {"workload", cfg.workload},
+        {"snapshot", cfg.dbPath},
+        {"clients", cfg.clients},
+        {"speed", cfg.speed},
+        {"statements", entries.size()},
+        {"errors", errors},
+        {"captured_s", capturedSeconds},
+        {"wall_s", seconds},
+        {"throughput_per_s", seconds > 0.0 ? static_cast<double>(entries.size()) / seconds : 0.0},
+        {"latency", HistogramJson(latency)},
+        {"schedule_lag", HistogramJson(lag)},
+        {"commands", commands}
+    };
+
+    if (cfg.outPath.empty())
+        std::cout << report.dump(2) << "\n";
+    else
+        std::ofstream(cfg.outPath) << report.dump(2) << "\n";
+    return 0;
+}